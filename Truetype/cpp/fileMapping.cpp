@@ -0,0 +1,159 @@
+#include "fileMapping.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Truetype
+{
+#ifdef _WIN32
+	MappedFile mapFile(const char* filepath)
+	{
+		MappedFile result = { nullptr, 0, nullptr, nullptr };
+
+		HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			printf("Error could not open file %s\n", filepath);
+			return result;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			printf("Error could not map empty file %s\n", filepath);
+			CloseHandle(file);
+			return result;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!mapping)
+		{
+			printf("Error could not create file mapping for %s\n", filepath);
+			CloseHandle(file);
+			return result;
+		}
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view)
+		{
+			printf("Error could not map view of file %s\n", filepath);
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return result;
+		}
+
+		result.data = (char*)view;
+		result.size = (size_t)size.QuadPart;
+		result.fileHandle = file;
+		result.mappingHandle = mapping;
+		return result;
+	}
+
+	void unmapFile(MappedFile& file)
+	{
+		if (file.data)
+		{
+			UnmapViewOfFile(file.data);
+		}
+		if (file.mappingHandle)
+		{
+			CloseHandle((HANDLE)file.mappingHandle);
+		}
+		if (file.fileHandle)
+		{
+			CloseHandle((HANDLE)file.fileHandle);
+		}
+		file = { nullptr, 0, nullptr, nullptr };
+	}
+#else
+	MappedFile mapFile(const char* filepath)
+	{
+		MappedFile result = { nullptr, 0, nullptr, nullptr };
+
+		int fd = open(filepath, O_RDONLY);
+		if (fd < 0)
+		{
+			printf("Error could not open file %s\n", filepath);
+			return result;
+		}
+
+		struct stat fileStats;
+		if (fstat(fd, &fileStats) != 0 || fileStats.st_size == 0)
+		{
+			printf("Error could not map empty file %s\n", filepath);
+			close(fd);
+			return result;
+		}
+
+		void* view = mmap(nullptr, (size_t)fileStats.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// The mapping keeps its own reference to the file
+		close(fd);
+		if (view == MAP_FAILED)
+		{
+			printf("Error could not map file %s\n", filepath);
+			return result;
+		}
+
+		result.data = (char*)view;
+		result.size = (size_t)fileStats.st_size;
+		return result;
+	}
+
+	void unmapFile(MappedFile& file)
+	{
+		if (file.data)
+		{
+			munmap(file.data, file.size);
+		}
+		file = { nullptr, 0, nullptr, nullptr };
+	}
+#endif
+
+	MappedFile readFileCopy(const char* filepath)
+	{
+		MappedFile result = { nullptr, 0, nullptr, nullptr };
+
+		FILE* file = fopen(filepath, "rb");
+		if (!file)
+		{
+			printf("Error could not open file %s\n", filepath);
+			return result;
+		}
+
+		fseek(file, 0, SEEK_END);
+		size_t size = ftell(file);
+		rewind(file);
+
+		char* data = (char*)malloc(sizeof(char) * size);
+		if (!data)
+		{
+			printf("Error could not allocate enough memory\n");
+			fclose(file);
+			return result;
+		}
+
+		size_t readAmt = fread(data, 1, size, file);
+		fclose(file);
+		if (readAmt != size)
+		{
+			printf("Error could not read file %s\n", filepath);
+			free(data);
+			return result;
+		}
+
+		result.data = data;
+		result.size = size;
+		return result;
+	}
+}
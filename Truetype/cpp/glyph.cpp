@@ -1,4 +1,10 @@
 #include "glyph.h"
+#include "metrics.h"
+#include "raster.h"
+#include "simd.h"
+
+#include <atomic>
+#include <thread>
 
 namespace Truetype
 {
@@ -15,9 +21,91 @@ namespace Truetype
 				return toULong(data + location + 8);
 			}
 		}
+
+		return 0;
+	}
+
+	static constexpr Tag makeTag(const char* str)
+	{
+		return ((uint32)(uint8)str[0] << 24) | ((uint32)(uint8)str[1] << 16) | ((uint32)(uint8)str[2] << 8) | (uint32)(uint8)str[3];
+	}
+
+	static TableType getTableType(Tag tag)
+	{
+		switch (tag)
+		{
+		case makeTag("cmap"): return TableType::Cmap;
+		case makeTag("glyf"): return TableType::Glyf;
+		case makeTag("head"): return TableType::Head;
+		case makeTag("hhea"): return TableType::Hhea;
+		case makeTag("hmtx"): return TableType::Hmtx;
+		case makeTag("loca"): return TableType::Loca;
+		case makeTag("maxp"): return TableType::Maxp;
+		case makeTag("name"): return TableType::Name;
+		case makeTag("OS/2"): return TableType::Os2;
+		case makeTag("post"): return TableType::Post;
+		case makeTag("kern"): return TableType::Kern;
+		case makeTag("GPOS"): return TableType::Gpos;
+		case makeTag("GSUB"): return TableType::Gsub;
+		case makeTag("fpgm"): return TableType::Fpgm;
+		case makeTag("prep"): return TableType::Prep;
+		case makeTag("cvt "): return TableType::Cvt;
+		case makeTag("SVG "): return TableType::Svg;
+		}
+
+		return TableType::Length;
 	}
 
-	uint32 getGlyphId(uint16 character, const FontInfo& fontInfo)
+	static void indexTables(FontInfo& fontInfo)
+	{
+		TableDirectory& tables = fontInfo.tables;
+		for (int i = 0; i < (int)TableType::Length; i++)
+		{
+			tables.records[i] = { 0, 0 };
+		}
+		tables.presentMask = 0;
+
+		Buffer buffer = getBuffer((uint8*)fontInfo.data, fontInfo.fontSize);
+		skip(buffer, fontInfo.fontStart + 4);
+		uint16 numTables = getUint16(buffer);
+		skip(buffer, 6);
+		for (int i = 0; i < numTables; i++)
+		{
+			Tag tag = getTag(buffer);
+			skip(buffer, 4);
+			uint32 offset = getUint32(buffer);
+			uint32 length = getUint32(buffer);
+
+			TableType type = getTableType(tag);
+			if (type == TableType::Length)
+			{
+				continue;
+			}
+
+			// Tables that do not fit inside the file are treated as missing, so everything
+			// marked present can be read without further bounds checks
+			if ((uint64)offset + (uint64)length > (uint64)fontInfo.fontSize)
+			{
+				printf("Table %d at offset %u extends past the end of the font file. Ignoring it.\n", (int)type, offset);
+				continue;
+			}
+
+			tables.records[(int)type] = { offset, length };
+			tables.presentMask |= 1u << (int)type;
+		}
+	}
+
+	bool hasTable(const FontInfo& fontInfo, TableType table)
+	{
+		return (fontInfo.tables.presentMask & (1u << (int)table)) != 0;
+	}
+
+	const TableRecord& getTable(const FontInfo& fontInfo, TableType table)
+	{
+		return fontInfo.tables.records[(int)table];
+	}
+
+	static void decodeCmapFormat4(FontInfo& fontInfo)
 	{
 		uint8* data = (uint8*)fontInfo.data;
 		uint32 cmapRecordOffset = fontInfo.cmap;
@@ -27,62 +115,435 @@ namespace Truetype
 		uint32 startCodeOffset = endCodeOffset + segCountX2 + 2;
 		uint32 idDeltaOffset = startCodeOffset + segCountX2;
 		uint32 idRangeOffsets = idDeltaOffset + segCountX2;
-		uint32 glyphIdArrayOffset = idRangeOffsets + segCountX2;
-
-		uint16* idRangeOffset = (uint16*)(data + idRangeOffsets);
-		uint16* idDeltaOffsetPtr = (uint16*)(data + idDeltaOffset);
-		uint16* startCode = (uint16*)(data + startCodeOffset);
-		uint16* endCode = (uint16*)(data + endCodeOffset);
+		if (idRangeOffsets + segCountX2 > (uint32)fontInfo.fontSize)
+		{
+			printf("Cmap subtable extends past the end of the font file.\n");
+			return;
+		}
 
-		TTF_ASSERT(endCode[segCount - 1] == 0xffff);
-		TTF_ASSERT(startCode[segCount - 1] == 0xffff);
-		uint16 segment = segCount;
+		fontInfo.cmapSegments = (CmapSegment*)allocate(sizeof(CmapSegment) * segCount);
+		int numSegments = 0;
 		for (uint16 i = 0; i < segCount; i++)
 		{
-			uint16 segStartCode = toUShort((uint8*)(startCode + i));
-			uint16 segEndCode = toUShort((uint8*)(endCode + i));
-			if (character >= segStartCode && character <= segEndCode)
+			CmapSegment segment;
+			segment.startCode = toUShort(data + startCodeOffset + i * 2);
+			segment.endCode = toUShort(data + endCodeOffset + i * 2);
+			segment.idDelta = toUShort(data + idDeltaOffset + i * 2);
+			segment.glyphIdArray = 0;
+
+			uint16 idRangeOffset = toUShort(data + idRangeOffsets + i * 2);
+			if (idRangeOffset != 0)
+			{
+				// idRangeOffset is relative to its own location in the idRangeOffsets array
+				segment.glyphIdArray = idRangeOffsets + i * 2 + idRangeOffset;
+			}
+
+			// Drop segments that are out of order or would read outside of the file, so lookups never need to check
+			bool isSorted = numSegments == 0 || segment.startCode > fontInfo.cmapSegments[numSegments - 1].endCode;
+			bool isInFile = segment.glyphIdArray == 0 ||
+				segment.glyphIdArray + ((uint32)segment.endCode - segment.startCode + 1) * 2 <= (uint32)fontInfo.fontSize;
+			if (segment.startCode > segment.endCode || !isSorted || !isInFile)
 			{
-				segment = i;
-				break;
+				continue;
 			}
+
+			fontInfo.cmapSegments[numSegments++] = segment;
 		}
+		fontInfo.numCmapSegments = numSegments;
+	}
 
-		if (segment == segCount)
+	static void decodeCmapFormat12(FontInfo& fontInfo)
+	{
+		uint8* data = (uint8*)fontInfo.data;
+		uint32 numGroups = toULong(data + fontInfo.cmap + 12);
+		uint32 groupsOffset = fontInfo.cmap + 16;
+		if ((uint64)groupsOffset + (uint64)numGroups * 12 > (uint64)fontInfo.fontSize)
+		{
+			printf("Cmap subtable extends past the end of the font file.\n");
+			return;
+		}
+
+		fontInfo.cmapGroups = (CmapGroup*)allocate(sizeof(CmapGroup) * numGroups);
+		int numValidGroups = 0;
+		for (uint32 i = 0; i < numGroups; i++)
+		{
+			uint8* groupPtr = data + groupsOffset + i * 12;
+			CmapGroup group;
+			group.startCharCode = toULong(groupPtr);
+			group.endCharCode = toULong(groupPtr + 4);
+			group.startGlyphId = toULong(groupPtr + 8);
+
+			// Drop groups that are out of order or outside of unicode, so lookups can binary search
+			bool isSorted = numValidGroups == 0 || group.startCharCode > fontInfo.cmapGroups[numValidGroups - 1].endCharCode;
+			if (group.startCharCode > group.endCharCode || group.endCharCode > 0x10FFFF || !isSorted)
+			{
+				continue;
+			}
+
+			fontInfo.cmapGroups[numValidGroups++] = group;
+		}
+		fontInfo.numCmapGroups = numValidGroups;
+	}
+
+	static inline uint16 getSegmentGlyphId(const CmapSegment& segment, uint32 codepoint, const FontInfo& fontInfo)
+	{
+		if (segment.glyphIdArray != 0)
+		{
+			return toUShort((uint8*)fontInfo.data + segment.glyphIdArray + (codepoint - segment.startCode) * 2);
+		}
+
+		// Modulo 65536 per the docs
+		return (uint16)(segment.idDelta + codepoint);
+	}
+
+	static inline uint16 getGroupGlyphId(const CmapGroup& group, uint32 codepoint, const FontInfo& fontInfo)
+	{
+		uint32 glyphId = fontInfo.cmapFormat == 13 ? group.startGlyphId : group.startGlyphId + (codepoint - group.startCharCode);
+		return glyphId < (uint32)fontInfo.numGlyphs ? (uint16)glyphId : 0;
+	}
+
+	// Returns the index of the first group whose endCharCode is >= codepoint, or numCmapGroups if there is none
+	static int lowerBoundCmapGroup(uint32 codepoint, const FontInfo& fontInfo)
+	{
+		const CmapGroup* groups = fontInfo.cmapGroups;
+		int low = 0;
+		int high = fontInfo.numCmapGroups;
+		while (low < high)
+		{
+			int mid = (low + high) / 2;
+			if (groups[mid].endCharCode < codepoint)
+			{
+				low = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		return low;
+	}
+
+	// Returns the index of the first segment whose endCode is >= codepoint, or numCmapSegments if there is none
+	static int lowerBoundCmapSegment(uint32 codepoint, const FontInfo& fontInfo)
+	{
+		if (codepoint > 0xFFFF)
+		{
+			return fontInfo.numCmapSegments;
+		}
+
+		const CmapSegment* segments = fontInfo.cmapSegments;
+		int low = 0;
+		int high = fontInfo.numCmapSegments;
+		while (low < high)
+		{
+			int mid = (low + high) / 2;
+			if (segments[mid].endCode < codepoint)
+			{
+				low = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		return low;
+	}
+
+	static uint32 getGroupStart(const CmapGroup& group) { return group.startCharCode; }
+	static uint32 getGroupEnd(const CmapGroup& group) { return group.endCharCode; }
+	static uint32 getSegmentStart(const CmapSegment& segment) { return segment.startCode; }
+	static uint32 getSegmentEnd(const CmapSegment& segment) { return segment.endCode; }
+
+	static uint16 findGlyphId(uint32 codepoint, const FontInfo& fontInfo)
+	{
+		if (fontInfo.cmapGroups)
+		{
+			int group = lowerBoundCmapGroup(codepoint, fontInfo);
+			if (group == fontInfo.numCmapGroups || fontInfo.cmapGroups[group].startCharCode > codepoint)
+			{
+				return 0;
+			}
+			return getGroupGlyphId(fontInfo.cmapGroups[group], codepoint, fontInfo);
+		}
+
+		int segment = lowerBoundCmapSegment(codepoint, fontInfo);
+		if (segment == fontInfo.numCmapSegments || fontInfo.cmapSegments[segment].startCode > codepoint)
 		{
 			return 0;
 		}
+		return getSegmentGlyphId(fontInfo.cmapSegments[segment], codepoint, fontInfo);
+	}
 
-		uint16 charIdRangeOffset = toUShort((uint8*)(idRangeOffset + segment));
-		uint16 charStartCode = toUShort((uint8*)(startCode + segment));
-		uint16 idDelta = toUShort((uint8*)(idDeltaOffsetPtr + segment));
+	static void setPageGlyphId(FontInfo& fontInfo, uint32 codepoint, uint16 glyphId)
+	{
+		if (glyphId == 0)
+		{
+			return;
+		}
 
-		uint16 val = 0;
-		if (charIdRangeOffset != 0)
+		if (codepoint < 256)
 		{
-			val = toUShort((uint8*)(&idRangeOffset[segment] + (charIdRangeOffset / 2 + (character - charStartCode))));
+			fontInfo.latin1Page[codepoint] = glyphId;
+			return;
 		}
-		else
+
+		uint16*& page = fontInfo.glyphPages[codepoint >> 8];
+		if (!page)
 		{
-			val = idDelta + character;
+			page = (uint16*)allocateZeroed(sizeof(uint16) * 256);
 		}
+		page[codepoint & 0xFF] = glyphId;
+	}
 
-		// Modulo 65536 per the docs
-		return val % 0xFFFF;
+	static void buildGlyphPages(FontInfo& fontInfo, bool buildAllPages)
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			fontInfo.latin1Page[i] = 0;
+		}
+
+		uint32 maxCodepoint = 0xFF;
+		if (buildAllPages)
+		{
+			// Only allocate page pointers up to the highest mapped codepoint
+			if (fontInfo.numCmapGroups > 0)
+			{
+				maxCodepoint = fontInfo.cmapGroups[fontInfo.numCmapGroups - 1].endCharCode;
+			}
+			else if (fontInfo.numCmapSegments > 0)
+			{
+				maxCodepoint = fontInfo.cmapSegments[fontInfo.numCmapSegments - 1].endCode;
+			}
+
+			fontInfo.numGlyphPages = (maxCodepoint >> 8) + 1;
+			fontInfo.glyphPages = (uint16**)allocate(sizeof(uint16*) * fontInfo.numGlyphPages);
+			for (int i = 0; i < fontInfo.numGlyphPages; i++)
+			{
+				fontInfo.glyphPages[i] = nullptr;
+			}
+			// Page 0 is latin1Page. It is never stored here, so a copied FontInfo doesn't point back into the original
+		}
+
+		for (int i = 0; i < fontInfo.numCmapGroups; i++)
+		{
+			const CmapGroup& group = fontInfo.cmapGroups[i];
+			uint32 end = group.endCharCode < maxCodepoint ? group.endCharCode : maxCodepoint;
+			for (uint32 c = group.startCharCode; c <= end; c++)
+			{
+				setPageGlyphId(fontInfo, c, getGroupGlyphId(group, c, fontInfo));
+			}
+		}
+
+		for (int i = 0; i < fontInfo.numCmapSegments; i++)
+		{
+			const CmapSegment& segment = fontInfo.cmapSegments[i];
+			uint32 end = segment.endCode < maxCodepoint ? segment.endCode : maxCodepoint;
+			for (uint32 c = segment.startCode; c <= end; c++)
+			{
+				setPageGlyphId(fontInfo, c, getSegmentGlyphId(segment, c, fontInfo));
+			}
+		}
 	}
 
-	Glyph getGlyph(uint16 character, const FontInfo& fontInfo)
+	uint32 getGlyphId(uint32 codepoint, const FontInfo& fontInfo)
 	{
-		uint8* data = (uint8*)fontInfo.data;
-		uint32 glyphId = getGlyphId(character, fontInfo);
+		if (codepoint < 256)
+		{
+			return fontInfo.latin1Page[codepoint];
+		}
+
+		if (fontInfo.glyphPages)
+		{
+			// Every mapped codepoint is in the page table, so a missing page means no glyph
+			uint32 pageIndex = codepoint >> 8;
+			if (pageIndex >= (uint32)fontInfo.numGlyphPages)
+			{
+				return 0;
+			}
+
+			const uint16* page = fontInfo.glyphPages[pageIndex];
+			return page ? page[codepoint & 0xFF] : 0;
+		}
+
+		return findGlyphId(codepoint, fontInfo);
+	}
+
+	static void getGlyphIdsFromPages(const uint32* codepoints, size_t numCodepoints, uint16* glyphIds, const FontInfo& fontInfo)
+	{
+		// Text tends to stay inside one page, so remember the last one
+		uint32 lastPageIndex = 0;
+		const uint16* lastPage = fontInfo.latin1Page;
+		for (size_t i = 0; i < numCodepoints; i++)
+		{
+			uint32 codepoint = codepoints[i];
+			uint32 pageIndex = codepoint >> 8;
+			if (pageIndex != lastPageIndex)
+			{
+				lastPageIndex = pageIndex;
+				if (pageIndex == 0)
+				{
+					lastPage = fontInfo.latin1Page;
+				}
+				else
+				{
+					lastPage = pageIndex < (uint32)fontInfo.numGlyphPages ? fontInfo.glyphPages[pageIndex] : nullptr;
+				}
+			}
+			glyphIds[i] = lastPage ? lastPage[codepoint & 0xFF] : 0;
+		}
+	}
+
+	template<typename Range, typename LowerBoundFn, typename GlyphFn>
+	static void getGlyphIdsFromRanges(const uint32* codepoints, size_t numCodepoints, uint16* glyphIds, const FontInfo& fontInfo,
+		const Range* ranges, int numRanges, LowerBoundFn lowerBound, GlyphFn getRangeGlyphId,
+		uint32 (*rangeStart)(const Range&), uint32 (*rangeEnd)(const Range&))
+	{
+		static const size_t blockSize = 64;
+
+		// Consecutive codepoints usually fall in the same range, so remember the last one. If the
+		// last codepoint was not mapped, remember the gap between ranges instead (lastRange is -1).
+		int lastRange = -1;
+		uint32 lastStart = 1;
+		uint32 lastEnd = 0;
+		for (size_t blockBegin = 0; blockBegin < numCodepoints; blockBegin += blockSize)
+		{
+			size_t blockEnd = blockBegin + blockSize < numCodepoints ? blockBegin + blockSize : numCodepoints;
+
+			uint32 blockMin = 0xFFFFFFFF;
+			uint32 blockMax = 0;
+			for (size_t i = blockBegin; i < blockEnd; i++)
+			{
+				blockMin = codepoints[i] < blockMin ? codepoints[i] : blockMin;
+				blockMax = codepoints[i] > blockMax ? codepoints[i] : blockMax;
+			}
+
+			// The whole block falls in the last range, no per codepoint range checks needed
+			if (blockMin >= lastStart && blockMax <= lastEnd)
+			{
+				if (lastRange < 0)
+				{
+					for (size_t i = blockBegin; i < blockEnd; i++)
+					{
+						glyphIds[i] = 0;
+					}
+					continue;
+				}
+
+				const Range& range = ranges[lastRange];
+				for (size_t i = blockBegin; i < blockEnd; i++)
+				{
+					glyphIds[i] = getRangeGlyphId(range, codepoints[i], fontInfo);
+				}
+				continue;
+			}
+
+			for (size_t i = blockBegin; i < blockEnd; i++)
+			{
+				uint32 codepoint = codepoints[i];
+				if (codepoint < 256)
+				{
+					glyphIds[i] = fontInfo.latin1Page[codepoint];
+					continue;
+				}
+
+				if (codepoint < lastStart || codepoint > lastEnd)
+				{
+					int index = lowerBound(codepoint, fontInfo);
+					if (index < numRanges && rangeStart(ranges[index]) <= codepoint)
+					{
+						lastRange = index;
+						lastStart = rangeStart(ranges[index]);
+						lastEnd = rangeEnd(ranges[index]);
+					}
+					else
+					{
+						lastRange = -1;
+						lastStart = index > 0 ? rangeEnd(ranges[index - 1]) + 1 : 0;
+						lastEnd = index < numRanges ? rangeStart(ranges[index]) - 1 : 0xFFFFFFFF;
+					}
+				}
+				glyphIds[i] = lastRange >= 0 ? getRangeGlyphId(ranges[lastRange], codepoint, fontInfo) : 0;
+			}
+		}
+	}
+
+	void getGlyphIds(const uint32* codepoints, size_t numCodepoints, uint16* glyphIds, const FontInfo& fontInfo)
+	{
+		if (fontInfo.glyphPages)
+		{
+			getGlyphIdsFromPages(codepoints, numCodepoints, glyphIds, fontInfo);
+		}
+		else if (fontInfo.cmapGroups)
+		{
+			getGlyphIdsFromRanges(codepoints, numCodepoints, glyphIds, fontInfo, fontInfo.cmapGroups, fontInfo.numCmapGroups,
+				lowerBoundCmapGroup, getGroupGlyphId, getGroupStart, getGroupEnd);
+		}
+		else
+		{
+			getGlyphIdsFromRanges(codepoints, numCodepoints, glyphIds, fontInfo, fontInfo.cmapSegments, fontInfo.numCmapSegments,
+				lowerBoundCmapSegment, getSegmentGlyphId, getSegmentStart, getSegmentEnd);
+		}
+	}
+
+	static void decodeLoca(FontInfo& fontInfo)
+	{
+		uint32 numOffsets = (uint32)fontInfo.numGlyphs + 1;
 
 		// Loca table uses the glyph id to find the correct offset
 		// If it is a short table version (i.e indexToLocFormat is 0)
-		// Then each entry in the table is 2 bytes, hence the * 2, and it is half the size of the actual offset
-		// Otherwise, each entry in the table is 4 bytes, hence the * 4, and it is the actual offset
+		// Then each entry in the table is 2 bytes, and it is half the size of the actual offset
+		// Otherwise, each entry in the table is 4 bytes, and it is the actual offset
+		const uint8* locaTablePtr = (uint8*)fontInfo.data + fontInfo.loca;
+		fontInfo.glyphOffsets = (uint32*)allocate(sizeof(uint32) * numOffsets);
+		if (fontInfo.indexToLocFormat == 0)
+		{
+			decodeBigEndianUint16sToUint32s(locaTablePtr, fontInfo.glyphOffsets, numOffsets, 2);
+		}
+		else
+		{
+			decodeBigEndianUint32s(locaTablePtr, fontInfo.glyphOffsets, numOffsets);
+		}
+	}
+
+	static inline uint32 getLocaOffset(uint32 glyphId, const FontInfo& fontInfo)
+	{
+		if (fontInfo.glyphOffsets)
+		{
+			return fontInfo.glyphOffsets[glyphId];
+		}
+
 		uint8* locaTablePtr = (uint8*)fontInfo.data + fontInfo.loca;
-		uint32 locaOffset = fontInfo.indexToLocFormat == 0 ? (uint32)(toUShort(locaTablePtr + glyphId * 2)) * 2 : toULong(locaTablePtr + glyphId * 4);
+		return fontInfo.indexToLocFormat == 0 ? (uint32)(toUShort(locaTablePtr + glyphId * 2)) * 2 : toULong(locaTablePtr + glyphId * 4);
+	}
+
+	uint32 getGlyphSize(uint32 glyphId, const FontInfo& fontInfo)
+	{
+		if (glyphId >= (uint32)fontInfo.numGlyphs)
+		{
+			return 0;
+		}
+
+		uint32 start = getLocaOffset(glyphId, fontInfo);
+		uint32 end = getLocaOffset(glyphId + 1, fontInfo);
+		return end > start ? end - start : 0;
+	}
+
+	Glyph getGlyph(uint32 codepoint, const FontInfo& fontInfo)
+	{
+		return getGlyphById(getGlyphId(codepoint, fontInfo), fontInfo);
+	}
 
+	Glyph getGlyphById(uint32 glyphId, const FontInfo& fontInfo)
+	{
+		uint8* data = (uint8*)fontInfo.data;
+
+		// Glyphs without any outline (like a space) have no data in the glyf table
+		if (getGlyphSize(glyphId, fontInfo) == 0)
+		{
+			return { 0, 0, 0, 0, 0, nullptr, nullptr, (uint16)glyphId };
+		}
+
+		uint32 locaOffset = getLocaOffset(glyphId, fontInfo);
 		uint8* glyphPtr = data + fontInfo.glyf + locaOffset;
 		Buffer glyphBuffer = getBuffer(glyphPtr, fontInfo);
 		int16 numberOfContours = getInt16(glyphBuffer);
@@ -100,7 +561,8 @@ namespace Truetype
 				xmax,
 				ymax,
 				(uint8*)glyphBuffer.data + glyphBuffer.cursor,
-				nullptr
+				nullptr,
+				(uint16)glyphId
 			};
 		}
 
@@ -111,406 +573,837 @@ namespace Truetype
 			xmax,
 			ymax,
 			nullptr,
-			(uint8*)glyphBuffer.data + glyphBuffer.cursor
+			(uint8*)glyphBuffer.data + glyphBuffer.cursor,
+			(uint16)glyphId
 		};
 	}
 
-	static int parametric(int16 p0, int16 p1, int16 p2, float t)
+	bool writeGlyphBitmap(const GlyphBitmap& bitmap, const char* fileLocation)
 	{
-		// Calculate the parametric equation for bezier curve using cValue as the parameter 
-		float tSquared = t * t;
-		float oneMinusT = (1.0f - t);
-		float oneMinusTSquared = oneMinusT * oneMinusT;
-		float floatResult = (oneMinusTSquared * (float)p0) + (2.0f * t * (float)p1 * oneMinusT) + (tSquared * (float)p2);
-		return (int)floatResult;
+		if (bitmap.width <= 0 || bitmap.height <= 0)
+		{
+			return false;
+		}
+
+		// stb_image_write reads rows top down and ours go up, so it starts at the top row and steps back a stride
+		// at a time. Its global flip flag is left alone for everything else that writes images.
+		if (bitmap.format == PixelFormat::Alpha8)
+		{
+			const uint8* topRow = bitmap.pixels + (ptrdiff_t)(bitmap.height - 1) * bitmap.stride;
+			return stbi_write_png(fileLocation, bitmap.width, bitmap.height, 1, topRow, -bitmap.stride) != 0;
+		}
+
+		// PNG can store 1-bit gray but stb_image_write can't, so the bits are expanded to bytes, top row first
+		uint8* expanded = (uint8*)allocate(sizeof(uint8) * bitmap.width * bitmap.height);
+		for (int y = 0; y < bitmap.height; y++)
+		{
+			const uint8* row = bitmap.pixels + (ptrdiff_t)y * bitmap.stride;
+			uint8* expandedRow = expanded + (bitmap.height - 1 - y) * bitmap.width;
+			for (int x = 0; x < bitmap.width; x++)
+			{
+				expandedRow[x] = (row[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0;
+			}
+		}
+		bool written = stbi_write_png(fileLocation, bitmap.width, bitmap.height, 1, expanded, bitmap.width) != 0;
+		deallocate(expanded);
+		return written;
 	}
 
-	static int parametric(int16 p0, int16 p1, float t)
+	static void drawSimpleGlyph(const Glyph& glyph, const FontInfo& fontInfo, const char* fileLocation)
 	{
-		// Calculate the parametric equation for bezier curve using cValue as the parameter 
-		float floatResult = (1.0f - t) * p0 + t * p1;
-		return (int16)floatResult;
+		// The whole font's height fits in 512 pixels
+		int16 fontHeight = fontInfo.yMax - fontInfo.yMin;
+		float pixelsPerEm = 512.0f * fontInfo.unitsPerEm / fontHeight;
+
+		Arena arena = createArena();
+		GlyphBitmap bitmap = rasterizeGlyph(glyph, fontInfo, createGlyphPlacement(pixelsPerEm), arena);
+		if (!writeGlyphBitmap(bitmap, fileLocation))
+		{
+			printf("Failure! Did not write glyph image properly.\n");
+		}
+		freeArena(arena);
 	}
 
-	static int max(int a, int b)
+	static size_t getGlyphScratchSize(int maxPoints, int maxContours)
 	{
-		return a > b ? a : b;
+		int outputCapacity = maxPoints * 2 + maxContours;
+		return sizeof(uint16) * maxContours + (sizeof(uint16) + sizeof(int16) * 2) * outputCapacity +
+			sizeof(int16) * 4 * maxPoints + sizeof(uint8) * maxPoints;
 	}
 
-	static int min(int a, int b)
+	// The decoded arrays come first and the working ones last, so a decode at the top of an arena can be
+	// compacted and the working arrays given back
+	static GlyphScratch layoutGlyphScratch(uint8* memory, int maxPoints, int maxContours)
 	{
-		return a < b ? a : b;
+		GlyphScratch scratch;
+		scratch.pointCapacity = maxPoints;
+		scratch.contourCapacity = maxContours;
+		scratch.outputCapacity = maxPoints * 2 + maxContours;
+		scratch.memory = memory;
+
+		scratch.contourEnds = (uint16*)memory;
+		memory += sizeof(uint16) * maxContours;
+		scratch.flags = (uint16*)memory;
+		memory += sizeof(uint16) * scratch.outputCapacity;
+		scratch.xCoords = (int16*)memory;
+		memory += sizeof(int16) * scratch.outputCapacity;
+		scratch.yCoords = (int16*)memory;
+		memory += sizeof(int16) * scratch.outputCapacity;
+		scratch.rawXCoords = (int16*)memory;
+		memory += sizeof(int16) * maxPoints;
+		scratch.rawYCoords = (int16*)memory;
+		memory += sizeof(int16) * maxPoints;
+		scratch.originalXCoords = (int16*)memory;
+		memory += sizeof(int16) * maxPoints;
+		scratch.originalYCoords = (int16*)memory;
+		memory += sizeof(int16) * maxPoints;
+		scratch.rawFlags = memory;
+		return scratch;
 	}
 
-	static int calculateWindingNumber(int16 p0x, int16 p0y, int16 p1x, int16 p1y, int16 p2x, int16 p2y, int16 x, int16 y)
+	GlyphScratch createGlyphScratch(int maxPoints, int maxContours)
 	{
-		// Translate the points to x's local space
-		p0x -= x;
-		p0y -= y;
-		p1x -= x;
-		p1y -= y;
-		p2x -= x;
-		p2y -= y;
+		uint8* memory = (uint8*)allocate(getGlyphScratchSize(maxPoints, maxContours));
+		return layoutGlyphScratch(memory, maxPoints, maxContours);
+	}
 
-		float a = (float)p0y - 2.0f * (float)p1y + (float)p2y;
-		float b = (float)p0y - (float)p1y;
-		float c = (float)p0y;
+	GlyphScratch createGlyphScratch(int maxPoints, int maxContours, Arena& arena)
+	{
+		uint8* memory = (uint8*)arenaAllocate(arena, getGlyphScratchSize(maxPoints, maxContours));
+		GlyphScratch scratch = layoutGlyphScratch(memory, maxPoints, maxContours);
 
-		float squareRootOperand = max(b * b - a * c, 0);
-		float squareRoot = sqrt(squareRootOperand);
+		// Owned by the arena, freeGlyphScratch leaves it alone
+		scratch.memory = nullptr;
+		return scratch;
+	}
 
-		float t0 = (b - squareRoot) / a;
-		float t1 = (b + squareRoot) / a;
-		if (abs(a) < 0.0001f)
-		{
-			// If a is nearly 0, solve for a linear equation instead of a quadratic equation
-			t0 = t1 = c / (2.0f * b);
-		}
+	// Composite glyphs get flattened into the same arrays, so make room for whichever is larger
+	static int getMaxGlyphPoints(const FontInfo& fontInfo)
+	{
+		return fontInfo.maxPoints > fontInfo.maxCompositePoints ? fontInfo.maxPoints : fontInfo.maxCompositePoints;
+	}
+
+	static int getMaxGlyphContours(const FontInfo& fontInfo)
+	{
+		return fontInfo.maxContours > fontInfo.maxCompositeContours ? fontInfo.maxContours : fontInfo.maxCompositeContours;
+	}
+
+	GlyphScratch createGlyphScratch(const FontInfo& fontInfo)
+	{
+		return createGlyphScratch(getMaxGlyphPoints(fontInfo), getMaxGlyphContours(fontInfo));
+	}
+
+	GlyphScratch createGlyphScratch(const FontInfo& fontInfo, Arena& arena)
+	{
+		return createGlyphScratch(getMaxGlyphPoints(fontInfo), getMaxGlyphContours(fontInfo), arena);
+	}
 
-		uint16 magicNumber = 0x2E74;
-		uint16 shiftAmount = ((p0y > 0) ? 2 : 0) + ((p1y > 0) ? 4 : 0) + ((p2y > 0) ? 8 : 0);
-		uint16 shiftedMagicNumber = magicNumber >> shiftAmount;
+	void freeGlyphScratch(GlyphScratch& scratch)
+	{
+		deallocate(scratch.memory);
+		scratch.memory = nullptr;
+		scratch.pointCapacity = 0;
+		scratch.contourCapacity = 0;
+		scratch.outputCapacity = 0;
+	}
 
-		int cxt0 = parametric(p0x, p1x, p2x, t0);
-		int cxt1 = parametric(p0x, p1x, p2x, t1);
+	static const GlyphData emptyGlyphData = {
+		0,
+		nullptr,
+		0,
+		nullptr,
+		nullptr,
+		nullptr
+	};
+
+	// How much of the scratch output a decode has filled. Composites append one component after another.
+	struct OutlineWriter
+	{
+		int numContours;
+		int numPoints;
+		int numOriginalPoints;
+	};
 
-		int result = 0;
-		if ((shiftedMagicNumber & 0x1) != 0 && cxt0 >= 0)
+	static GlyphData getWrittenGlyphData(const GlyphScratch& scratch, const OutlineWriter& writer)
+	{
+		return {
+			(int16)writer.numContours,
+			scratch.contourEnds,
+			(uint16)writer.numPoints,
+			scratch.flags,
+			scratch.xCoords,
+			scratch.yCoords
+		};
+	}
+
+	// Reads the contour ends and returns the number of points in a simple glyph, or 0 if it cannot be read
+	static int getSimpleGlyphNumPoints(const Glyph& glyph, const FontInfo& fontInfo)
+	{
+		if (glyph.numberOfContours <= 0 || glyph.simpleGlyphTable == nullptr)
 		{
-			result++;
+			return 0;
 		}
-		if ((shiftedMagicNumber & 0x2) != 0 && cxt1 >= 0)
+
+		Buffer dataBuffer = getBuffer(glyph.simpleGlyphTable, fontInfo);
+		if (!canRead(dataBuffer, glyph.numberOfContours * 2 + 2))
 		{
-			result--;
+			return 0;
 		}
-		return result;
-	}
 
-	static int calculateWindingNumber(int16 p0x, int16 p0y, int16 p1x, int16 p1y, int16 x, int16 y)
-	{
-		// Treat like bezier curve with control point in linear fashion
-		int16 midx = (p0x + p1x) / 2;
-		int16 midy = (p0y + p1y) / 2;
-		return calculateWindingNumber(p0x, p0y, midx, midy, p1x, p1y, x, y);
+		// Contour ends have to be strictly increasing. Everything that walks contours relies on it to size and
+		// bound the point arrays, so a glyph that breaks it can't be read.
+		int previousEnd = -1;
+		for (int i = 0; i < glyph.numberOfContours; i++)
+		{
+			int contourEnd = getUint16(dataBuffer);
+			if (contourEnd <= previousEnd)
+			{
+				return 0;
+			}
+			previousEnd = contourEnd;
+		}
+		return previousEnd + 1;
 	}
 
-	static int calculateWindingNumber(int numPoints, uint16* finalFlags, int16* xCoords, int16* yCoords, int numContours, uint16* contourEnds, int x, int y,
-		const Glyph& glyph, float canvasWidth, float canvasHeight)
+	bool getSimpleGlyphLayout(const Glyph& glyph, const FontInfo& fontInfo, SimpleGlyphLayout& layout)
 	{
-		float maxX = (float)glyph.xMax;
-		float minX = (float)glyph.xMin;
-		float maxY = (float)glyph.yMax;
-		float minY = (float)glyph.yMin;
+		layout.numPoints = getSimpleGlyphNumPoints(glyph, fontInfo);
+		if (layout.numPoints == 0)
+		{
+			return false;
+		}
 
-		// Map coordinates from canvas range to glyph range
-		float newX = ((float)x / canvasWidth) * (maxX - minX) + minX;
-		float newY = ((float)y / canvasHeight) * (maxY - minY) + minY;
-		int16 pixelX = (int16)newX;
-		int16 pixelY = (int16)newY;
+		Buffer dataBuffer = getBuffer(glyph.simpleGlyphTable, fontInfo);
+		layout.numContours = glyph.numberOfContours;
+		layout.contourEnds = cursorPtr(dataBuffer);
+		skip(dataBuffer, glyph.numberOfContours * 2);
 
-		// If the winding number is 0, pixel is off, otherwise pixel is on
-		int windingNumber = 0;
-		uint16 point = 0;
-		for (uint16 i = 0; i < numContours; i++)
+		// TODO: ADD INSTRUCTION SUPPORT?
+		uint16 instructionsLength = getUint16(dataBuffer);
+		if (!canRead(dataBuffer, instructionsLength))
+		{
+			return false;
+		}
+		skip(dataBuffer, instructionsLength);
+		layout.flags = cursorPtr(dataBuffer);
+
+		// Walk the flag runs and add up how many bytes the x and y coordinates take so those spans
+		// can be bounds checked once instead of per coordinate
+		int xBytes = 0;
+		int yBytes = 0;
+		for (int i = 0; i < layout.numPoints;)
 		{
-			uint16 contourEnd = contourEnds[i];
-			uint16 contourBegin = point;
-			for (; point < contourEnd; point++)
+			if (!canRead(dataBuffer, 1))
 			{
-				// 0x01 is the flag for ON_CURVE_POINT
-				// Two on points means it's a straight line
-				if (finalFlags[point] && finalFlags[point + 1])
+				return false;
+			}
+			uint8 flag = getUint8(dataBuffer);
+			int repeatCount = 1;
+			if (flag & REPEAT)
+			{
+				if (!canRead(dataBuffer, 1))
 				{
-					windingNumber += calculateWindingNumber(xCoords[point], yCoords[point], xCoords[point + 1], yCoords[point + 1], pixelX, pixelY);
+					return false;
 				}
-				// On point, off point, on point is a standard bezier curve
-				else if (finalFlags[point] && !finalFlags[point + 1] && finalFlags[point + 2])
+				repeatCount += getUint8(dataBuffer);
+				if (i + repeatCount > layout.numPoints)
 				{
-					// Swap coords if anticlockwise
-					// We enter here.
-					windingNumber += calculateWindingNumber(xCoords[point], yCoords[point], xCoords[point + 1], yCoords[point + 1], xCoords[point + 2], yCoords[point + 2], pixelX, pixelY);
-					point++;
+					repeatCount = layout.numPoints - i;
 				}
 			}
-			point++;
+
+			int xSize = (flag & X_IS_BYTE) ? 1 : ((flag & X_DELTA) ? 0 : 2);
+			int ySize = (flag & Y_IS_BYTE) ? 1 : ((flag & Y_DELTA) ? 0 : 2);
+			xBytes += xSize * repeatCount;
+			yBytes += ySize * repeatCount;
+			i += repeatCount;
 		}
 
+		if (!canRead(dataBuffer, xBytes + yBytes))
+		{
+			return false;
+		}
 
-		return windingNumber;
+		layout.xCoords = cursorPtr(dataBuffer);
+		layout.yCoords = layout.xCoords + xBytes;
+		return true;
 	}
 
-	static void drawSimpleGlyph(const Glyph& glyph, const FontInfo& fontInfo, const char* fileLocation)
+	// Decodes a simple glyph and appends it to the writer's output. The points as stored in the glyf table are
+	// left in the raw arrays. Returns the number of raw points, or 0 if the glyph could not be decoded.
+	static int decodeSimpleGlyph(const Glyph& glyph, const FontInfo& fontInfo, GlyphScratch& scratch, OutlineWriter& writer)
 	{
-		GlyphData glyphData = getGlyphData(glyph, fontInfo);
+		SimpleGlyphLayout layout;
+		if (!getSimpleGlyphLayout(glyph, fontInfo, layout))
+		{
+			return 0;
+		}
 
-		float scale = 128.0f / fontInfo.unitsPerEm;
-		int16 glyphWidth = glyph.xMax - glyph.xMin;
-		int16 glyphHeight = glyph.yMax - glyph.yMin;
-		int16 fontWidth = fontInfo.xMax - fontInfo.xMin;
-		int16 fontHeight = fontInfo.yMax - fontInfo.yMin;
+		int numPoints = layout.numPoints;
+		if (numPoints > scratch.pointCapacity || writer.numContours + glyph.numberOfContours > scratch.contourCapacity)
+		{
+			return 0;
+		}
+
+		uint16* contourEnds = scratch.contourEnds + writer.numContours;
+		for (int c = 0; c < glyph.numberOfContours; c++)
+		{
+			contourEnds[c] = loadUint16(layout.contourEnds + c * 2);
+		}
 
-		float fontRatio = (float)fontWidth / (float)fontHeight;
-		int16 canvasWidth = ((float)glyphWidth / (float)fontWidth) * 512.0f * fontRatio;
-		int16 canvasHeight = ((float)glyphHeight / (float)fontHeight) * 512.0f;
-
-		uint8* fileOutput = (uint8*)malloc(sizeof(uint8) * 3 * canvasWidth * canvasHeight);
-		for (int y = 0; y < canvasHeight; y++)
-		{
-			for (int x = 0; x < canvasWidth * 3; x += 3)
-			{
-				int windingNumber = calculateWindingNumber(
-					glyphData.numPoints,
-					glyphData.flags,
-					glyphData.xCoords,
-					glyphData.yCoords,
-					glyph.numberOfContours,
-					glyphData.contourEnds,
-					x / 3,
-					y,
-					glyph,
-					canvasWidth,
-					canvasHeight
-				);
-				if (windingNumber == 0)
+		uint8* flagBuffer = scratch.rawFlags;
+		int16* xPoints = scratch.rawXCoords;
+		int16* yPoints = scratch.rawYCoords;
+
+		// The layout already checked the flag runs, expand them to one flag per point
+		const uint8* flags = layout.flags;
+		for (int i = 0; i < numPoints;)
+		{
+			uint8 flag = *flags++;
+			int repeatCount = 1;
+			if (flag & REPEAT)
+			{
+				repeatCount += *flags++;
+				if (i + repeatCount > numPoints)
 				{
-					fileOutput[(y * canvasWidth * 3) + x + 0] = 0;
-					fileOutput[(y * canvasWidth * 3) + x + 1] = 0;
-					fileOutput[(y * canvasWidth * 3) + x + 2] = 0;
+					repeatCount = numPoints - i;
 				}
-				else
+			}
+			memset(flagBuffer + i, flag, repeatCount);
+			i += repeatCount;
+		}
+
+		const uint8* readEnd = (const uint8*)fontInfo.data + fontInfo.fontSize;
+		decodeGlyphCoordinates(flagBuffer, numPoints, layout.xCoords, readEnd, xPoints, X_IS_BYTE, X_DELTA);
+		decodeGlyphCoordinates(flagBuffer, numPoints, layout.yCoords, readEnd, yPoints, Y_IS_BYTE, Y_DELTA);
+
+		// Get an adjusted number of points by counting "ghost" points between two consecutive
+		// "off" points in the same contour, including the last and first points of a contour,
+		// plus one point per contour to close it
+		int adjustedNumPoints = numPoints + glyph.numberOfContours;
+		int contourBegin = 0;
+		for (int c = 0; c < glyph.numberOfContours; c++)
+		{
+			for (int i = contourBegin; i < contourEnds[c]; i++)
+			{
+				if (!(flagBuffer[i] & ON_CURVE) && !(flagBuffer[i + 1] & ON_CURVE))
 				{
-					fileOutput[(y * canvasWidth * 3) + x + 0] = 255;
-					fileOutput[(y * canvasWidth * 3) + x + 1] = 255;
-					fileOutput[(y * canvasWidth * 3) + x + 2] = 255;
+					adjustedNumPoints++;
 				}
 			}
+			if (contourBegin < contourEnds[c] && !(flagBuffer[contourBegin] & ON_CURVE) && !(flagBuffer[contourEnds[c]] & ON_CURVE))
+			{
+				adjustedNumPoints++;
+			}
+			contourBegin = contourEnds[c] + 1;
 		}
 
-		stbi_flip_vertically_on_write(1);
-		if (!stbi_write_png(fileLocation, canvasWidth, canvasHeight, 3, fileOutput, canvasWidth * 3))
+		int totalNumPoints = writer.numPoints + adjustedNumPoints;
+		if (totalNumPoints > scratch.outputCapacity || totalNumPoints > 0xFFFF)
 		{
-			printf("Failure! Did not write glyph image properly.\n");
+			return 0;
+		}
+
+		int16* finalXPoints = scratch.xCoords;
+		int16* finalYPoints = scratch.yCoords;
+		uint16* finalFlags = scratch.flags;
+		int currentIndex = writer.numPoints;
+		contourBegin = 0;
+		for (int c = 0; c < glyph.numberOfContours; c++)
+		{
+			int contourStart = currentIndex;
+			uint16 contourEnd = contourEnds[c];
+			for (int i = contourBegin; i <= contourEnd; i++)
+			{
+				finalXPoints[currentIndex] = xPoints[i];
+				finalYPoints[currentIndex] = yPoints[i];
+				finalFlags[currentIndex] = flagBuffer[i] & ON_CURVE ? 1 : 0;
+				currentIndex++;
+
+				// Two off points, generate the implied on point in between them. The last point pairs with the first.
+				int next = i < contourEnd ? i + 1 : contourBegin;
+				if (next != i && !(flagBuffer[i] & ON_CURVE) && !(flagBuffer[next] & ON_CURVE))
+				{
+					finalXPoints[currentIndex] = (xPoints[i] + xPoints[next]) / 2;
+					finalYPoints[currentIndex] = (yPoints[i] + yPoints[next]) / 2;
+					finalFlags[currentIndex] = 1;
+					currentIndex++;
+				}
+			}
+
+			// At the end of a contour, add one extra point to connect the last point to the first point
+			finalXPoints[currentIndex] = finalXPoints[contourStart];
+			finalYPoints[currentIndex] = finalYPoints[contourStart];
+			finalFlags[currentIndex] = finalFlags[contourStart];
+			contourEnds[c] = currentIndex;
+			currentIndex++;
+			contourBegin = contourEnd + 1;
 		}
 
-		freeGlyphData(glyphData);
-		free(fileOutput);
+		writer.numContours += glyph.numberOfContours;
+		writer.numPoints = totalNumPoints;
+		return numPoints;
+	}
+
+	static bool isIdentity(const ComponentMatrix& m)
+	{
+		return m.a == 1.0f && m.b == 0.0f && m.c == 0.0f && m.d == 1.0f;
+	}
+
+	static int16 roundToInt16(float value)
+	{
+		return (int16)(value < 0.0f ? value - 0.5f : value + 0.5f);
+	}
+
+	static void transformPoints(int16* xCoords, int16* yCoords, int begin, int end, const ComponentMatrix& m)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			transformPoint(m, xCoords[i], yCoords[i]);
+		}
+	}
+
+	void transformPoint(const ComponentMatrix& m, int16& x, int16& y)
+	{
+		float fx = x;
+		float fy = y;
+		x = roundToInt16(m.a * fx + m.c * fy);
+		y = roundToInt16(m.b * fx + m.d * fy);
+	}
+
+	static void translatePoints(int16* xCoords, int16* yCoords, int begin, int end, int16 dx, int16 dy)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			xCoords[i] += dx;
+			yCoords[i] += dy;
+		}
+	}
+
+	static float getF2Dot14(Buffer& buffer)
+	{
+		return (float)getInt16(buffer) / 16384.0f;
+	}
+
+	bool readGlyphComponent(Buffer& buffer, GlyphComponent& component)
+	{
+		if (!canRead(buffer, 4))
+		{
+			return false;
+		}
+		uint16 flags = getUint16(buffer);
+		component.flags = flags;
+		component.glyphId = getUint16(buffer);
+
+		int argsSize = (flags & ARG_1_AND_2_ARE_WORDS) ? 4 : 2;
+		int transformSize = (flags & WE_HAVE_A_SCALE) ? 2 : ((flags & WE_HAVE_AN_X_AND_Y_SCALE) ? 4 : ((flags & WE_HAVE_A_TWO_BY_TWO) ? 8 : 0));
+		if (!canRead(buffer, argsSize + transformSize))
+		{
+			return false;
+		}
+
+		// Offsets are signed, point numbers are not
+		if (flags & ARG_1_AND_2_ARE_WORDS)
+		{
+			component.arg1 = (flags & ARGS_ARE_XY_VALUES) ? getInt16(buffer) : getUint16(buffer);
+			component.arg2 = (flags & ARGS_ARE_XY_VALUES) ? getInt16(buffer) : getUint16(buffer);
+		}
+		else
+		{
+			component.arg1 = (flags & ARGS_ARE_XY_VALUES) ? (int8)getUint8(buffer) : getUint8(buffer);
+			component.arg2 = (flags & ARGS_ARE_XY_VALUES) ? (int8)getUint8(buffer) : getUint8(buffer);
+		}
+
+		component.matrix = { 1.0f, 0.0f, 0.0f, 1.0f };
+		if (flags & WE_HAVE_A_SCALE)
+		{
+			component.matrix.a = component.matrix.d = getF2Dot14(buffer);
+		}
+		else if (flags & WE_HAVE_AN_X_AND_Y_SCALE)
+		{
+			component.matrix.a = getF2Dot14(buffer);
+			component.matrix.d = getF2Dot14(buffer);
+		}
+		else if (flags & WE_HAVE_A_TWO_BY_TWO)
+		{
+			component.matrix.a = getF2Dot14(buffer);
+			component.matrix.b = getF2Dot14(buffer);
+			component.matrix.c = getF2Dot14(buffer);
+			component.matrix.d = getF2Dot14(buffer);
+		}
+		return true;
+	}
+
+	ComponentMatrix combineComponentMatrices(const ComponentMatrix& parent, const ComponentMatrix& component)
+	{
+		return {
+			parent.a * component.a + parent.c * component.b,
+			parent.b * component.a + parent.d * component.b,
+			parent.a * component.c + parent.c * component.d,
+			parent.b * component.c + parent.d * component.d
+		};
+	}
+
+	void getComponentOffset(const GlyphComponent& component, const ComponentMatrix& parent, const ComponentMatrix& combined,
+		int16& offsetX, int16& offsetY)
+	{
+		// The offset is in the parent's space, unless the font asks for it to be scaled with the component
+		bool scaled = (component.flags & SCALED_COMPONENT_OFFSET) && !(component.flags & UNSCALED_COMPONENT_OFFSET);
+		const ComponentMatrix& offsetMatrix = scaled ? combined : parent;
+		offsetX = roundToInt16(offsetMatrix.a * component.arg1 + offsetMatrix.c * component.arg2);
+		offsetY = roundToInt16(offsetMatrix.b * component.arg1 + offsetMatrix.d * component.arg2);
+	}
+
+	// Appends a glyph's outline to the writer with the accumulated 2x2 transform of the components above it applied.
+	// Offsets are applied by the caller, once the whole component is in place.
+	static bool appendGlyphOutline(const Glyph& glyph, const ComponentMatrix& matrix, int depth, const FontInfo& fontInfo,
+		GlyphScratch& scratch, OutlineWriter& writer)
+	{
+		if (glyph.numberOfContours == 0)
+		{
+			return true;
+		}
+
+		if (glyph.numberOfContours > 0)
+		{
+			int pointBegin = writer.numPoints;
+			int numRawPoints = decodeSimpleGlyph(glyph, fontInfo, scratch, writer);
+			if (numRawPoints == 0 || writer.numOriginalPoints + numRawPoints > scratch.pointCapacity)
+			{
+				return false;
+			}
+
+			int originalBegin = writer.numOriginalPoints;
+			memcpy(scratch.originalXCoords + originalBegin, scratch.rawXCoords, sizeof(int16) * numRawPoints);
+			memcpy(scratch.originalYCoords + originalBegin, scratch.rawYCoords, sizeof(int16) * numRawPoints);
+			writer.numOriginalPoints += numRawPoints;
+
+			if (!isIdentity(matrix))
+			{
+				transformPoints(scratch.xCoords, scratch.yCoords, pointBegin, writer.numPoints, matrix);
+				transformPoints(scratch.originalXCoords, scratch.originalYCoords, originalBegin, writer.numOriginalPoints, matrix);
+			}
+			return true;
+		}
+
+		if (depth >= MAX_COMPONENT_DEPTH || glyph.compositeGlyphTable == nullptr)
+		{
+			return false;
+		}
+
+		int compositeOriginalBegin = writer.numOriginalPoints;
+		Buffer buffer = getBuffer(glyph.compositeGlyphTable, fontInfo);
+		GlyphComponent component;
+		do
+		{
+			if (!readGlyphComponent(buffer, component))
+			{
+				return false;
+			}
+
+			ComponentMatrix combined = combineComponentMatrices(matrix, component.matrix);
+			int pointBegin = writer.numPoints;
+			int originalBegin = writer.numOriginalPoints;
+			if (component.glyphId >= fontInfo.numGlyphs ||
+				!appendGlyphOutline(getGlyphById(component.glyphId, fontInfo), combined, depth + 1, fontInfo, scratch, writer))
+			{
+				return false;
+			}
+
+			int16 offsetX, offsetY;
+			if (component.flags & ARGS_ARE_XY_VALUES)
+			{
+				getComponentOffset(component, matrix, combined, offsetX, offsetY);
+			}
+			else
+			{
+				// Move the component so its point arg2 lands on point arg1 of the components before it
+				int parentPoint = compositeOriginalBegin + component.arg1;
+				int childPoint = originalBegin + component.arg2;
+				if (parentPoint >= originalBegin || childPoint >= writer.numOriginalPoints)
+				{
+					return false;
+				}
+				offsetX = scratch.originalXCoords[parentPoint] - scratch.originalXCoords[childPoint];
+				offsetY = scratch.originalYCoords[parentPoint] - scratch.originalYCoords[childPoint];
+			}
+
+			if (offsetX != 0 || offsetY != 0)
+			{
+				translatePoints(scratch.xCoords, scratch.yCoords, pointBegin, writer.numPoints, offsetX, offsetY);
+				translatePoints(scratch.originalXCoords, scratch.originalYCoords, originalBegin, writer.numOriginalPoints, offsetX, offsetY);
+			}
+		} while (component.flags & MORE_COMPONENTS);
+
+		return true;
 	}
 
-	GlyphData getGlyphData(const Glyph& glyph, const FontInfo& fontInfo)
+	// Adds up the points and contours of the simple glyphs under a composite, which is all the room flattening it
+	// needs. Returns false if a component can't be read, the same glyphs appendGlyphOutline gives up on.
+	static bool countComponentPoints(const Glyph& glyph, const FontInfo& fontInfo, int depth, int& numPoints, int& numContours)
 	{
-		static uint16 ON_CURVE = 0x01;
-		static uint16 X_IS_BYTE = 0x02;
-		static uint16 Y_IS_BYTE = 0x04;
-		static uint16 REPEAT = 0x08;
-		static uint16 X_DELTA = 0x10;
-		static uint16 Y_DELTA = 0x20;
-
 		if (glyph.numberOfContours == 0)
 		{
-			return {
-				0,
-				nullptr,
-				0,
-				nullptr,
-				nullptr,
-				nullptr
-			};
+			return true;
 		}
 
-		uint16* endPtsOfContours = (uint16*)glyph.simpleGlyphTable;
-		uint16 instructionsLength = toUShort((uint8*)&endPtsOfContours[glyph.numberOfContours]);
-		uint8* instructions = (uint8*)(endPtsOfContours + glyph.numberOfContours + 1);
+		if (glyph.numberOfContours > 0)
+		{
+			int glyphPoints = getSimpleGlyphNumPoints(glyph, fontInfo);
+			numPoints += glyphPoints;
+			numContours += glyph.numberOfContours;
+			return glyphPoints != 0;
+		}
 
-		uint16* contourEnds = (uint16*)malloc(sizeof(uint16) * glyph.numberOfContours);
-		uint16 numPoints = 0;
-		for (int i = 0; i < glyph.numberOfContours; i++)
+		if (depth >= MAX_COMPONENT_DEPTH || glyph.compositeGlyphTable == nullptr)
 		{
-			contourEnds[i] = toUShort((uint8*)(endPtsOfContours + i));
+			return false;
+		}
 
-			if (contourEnds[i] > numPoints)
+		Buffer buffer = getBuffer(glyph.compositeGlyphTable, fontInfo);
+		GlyphComponent component;
+		do
+		{
+			if (!readGlyphComponent(buffer, component) || component.glyphId >= fontInfo.numGlyphs ||
+				!countComponentPoints(getGlyphById(component.glyphId, fontInfo), fontInfo, depth + 1, numPoints, numContours))
 			{
-				numPoints = contourEnds[i];
+				return false;
 			}
-		}
-		TTF_ASSERT(numPoints != 0);
-		numPoints++;
-
-		uint8* dataPtr = instructions + instructionsLength;
-		if (instructionsLength == 0) dataPtr++;
-		// TODO: ADD INSTRUCTION SUPPORT?
+		} while (component.flags & MORE_COMPONENTS);
 
-		uint16* flagBuffer = (uint16*)malloc(sizeof(uint16) * numPoints);
-		int16* xPoints = (int16*)malloc(sizeof(int16) * numPoints);
-		int16* yPoints = (int16*)malloc(sizeof(int16) * numPoints);
+		return true;
+	}
 
-		Buffer dataBuffer = getBuffer(dataPtr, fontInfo);
-		for (uint16 i = 0; i < numPoints; i++)
+	// Finds the largest glyphs from the glyph headers, for fonts whose maxp doesn't have them
+	static void findGlyphMaxima(FontInfo& fontInfo)
+	{
+		for (int i = 0; i < fontInfo.numGlyphs; i++)
 		{
-			uint8 flag = getUint8(dataBuffer);
-			flagBuffer[i] = flag;
-
-			if (flag & REPEAT)
+			Glyph glyph = getGlyphById(i, fontInfo);
+			int numPoints = 0;
+			int numContours = 0;
+			if (glyph.numberOfContours > 0)
 			{
-				uint8 repeatCount = getUint8(dataBuffer);
-				TTF_ASSERT(repeatCount > 0);
-				for (int j = 0; j < repeatCount; j++)
+				numPoints = getSimpleGlyphNumPoints(glyph, fontInfo);
+				if (numPoints > 0)
 				{
-					flagBuffer[i + j + 1] = flag;
+					fontInfo.maxPoints = numPoints > fontInfo.maxPoints ? numPoints : fontInfo.maxPoints;
+					fontInfo.maxContours = glyph.numberOfContours > fontInfo.maxContours ? glyph.numberOfContours : fontInfo.maxContours;
 				}
-				i += repeatCount;
 			}
-		}
-
-		// Get an adjusted number of points by counting "ghost" points
-		uint16 adjustedNumPoints = numPoints;
-		bool onCurve = true;
-		for (uint16 i = 0; i < numPoints; i++)
-		{
-			uint16 flag = flagBuffer[i];
-			if (!(flag & ON_CURVE) && !onCurve)
+			else if (glyph.numberOfContours < 0 && countComponentPoints(glyph, fontInfo, 0, numPoints, numContours))
 			{
-				// If we are between two "off" points, add this "ghost" point
-				adjustedNumPoints++;
+				fontInfo.maxCompositePoints = numPoints > fontInfo.maxCompositePoints ? numPoints : fontInfo.maxCompositePoints;
+				fontInfo.maxCompositeContours = numContours > fontInfo.maxCompositeContours ? numContours : fontInfo.maxCompositeContours;
 			}
+		}
+	}
 
-			if (!(flag & ON_CURVE))
+	// Decodes a simple glyph or flattens a composite one into the scratch
+	static GlyphData decodeGlyph(const Glyph& glyph, const FontInfo& fontInfo, GlyphScratch& scratch)
+	{
+		OutlineWriter writer = { 0, 0, 0 };
+		if (glyph.numberOfContours > 0)
+		{
+			if (decodeSimpleGlyph(glyph, fontInfo, scratch, writer) == 0)
 			{
-				onCurve = false;
+				return emptyGlyphData;
 			}
-			else
+		}
+		else if (glyph.numberOfContours < 0)
+		{
+			ComponentMatrix identity = { 1.0f, 0.0f, 0.0f, 1.0f };
+			if (!appendGlyphOutline(glyph, identity, 0, fontInfo, scratch, writer))
 			{
-				onCurve = true;
+				return emptyGlyphData;
 			}
+		}
+		return getWrittenGlyphData(scratch, writer);
+	}
+
+	static const GlyphData* getCachedCompositeGlyph(const Glyph& glyph, const FontInfo& fontInfo)
+	{
+		if (glyph.numberOfContours < 0 && fontInfo.compositeGlyphs != nullptr && glyph.id < fontInfo.numGlyphs)
+		{
+			return &fontInfo.compositeGlyphs[glyph.id];
+		}
+		return nullptr;
+	}
 
+	static size_t getGlyphDataSize(const GlyphData& glyphData)
+	{
+		return sizeof(uint16) * glyphData.numContours + (sizeof(uint16) + sizeof(int16) * 2) * glyphData.numPoints;
+	}
+
+	// Copies the outline into one block of memory, contour ends first and then the flags, x and y coordinates
+	static GlyphData copyGlyphData(const GlyphData& glyphData, uint8* memory)
+	{
+		GlyphData copy;
+		copy.numContours = glyphData.numContours;
+		copy.numPoints = glyphData.numPoints;
+		copy.contourEnds = (uint16*)memory;
+		copy.flags = copy.contourEnds + copy.numContours;
+		copy.xCoords = (int16*)(copy.flags + copy.numPoints);
+		copy.yCoords = copy.xCoords + copy.numPoints;
+		memmove(copy.contourEnds, glyphData.contourEnds, sizeof(uint16) * copy.numContours);
+		memmove(copy.flags, glyphData.flags, sizeof(uint16) * copy.numPoints);
+		memmove(copy.xCoords, glyphData.xCoords, sizeof(int16) * copy.numPoints);
+		memmove(copy.yCoords, glyphData.yCoords, sizeof(int16) * copy.numPoints);
+		return copy;
+	}
+
+	GlyphData getGlyphData(const Glyph& glyph, const FontInfo& fontInfo, GlyphScratch& scratch)
+	{
+		const GlyphData* cached = getCachedCompositeGlyph(glyph, fontInfo);
+		if (cached)
+		{
+			return *cached;
 		}
+		return decodeGlyph(glyph, fontInfo, scratch);
+	}
 
-		// We read all the flags, now we are at xcoords
-		int16 value = 0;
-		for (uint16 i = 0; i < numPoints; i++)
+	GlyphData getGlyphData(const Glyph& glyph, const FontInfo& fontInfo, Arena& arena)
+	{
+		const GlyphData* cached = getCachedCompositeGlyph(glyph, fontInfo);
+		if (cached)
 		{
-			uint16 flag = flagBuffer[i];
-			if (flag & X_IS_BYTE)
+			if (cached->numPoints == 0)
 			{
-				if (flag & X_DELTA)
-				{
-					value += getUint8(dataBuffer);
-				}
-				else
-				{
-					value -= getUint8(dataBuffer);
-				}
+				return emptyGlyphData;
 			}
-			else if (~flag & X_DELTA)
+			return copyGlyphData(*cached, (uint8*)arenaAllocate(arena, getGlyphDataSize(*cached)));
+		}
+
+		// Scratch is sized exactly for the glyph, composites by the simple glyphs they are built from
+		int numPoints = getSimpleGlyphNumPoints(glyph, fontInfo);
+		int numContours = glyph.numberOfContours;
+		if (glyph.numberOfContours < 0)
+		{
+			numPoints = 0;
+			numContours = 0;
+			if (!countComponentPoints(glyph, fontInfo, 0, numPoints, numContours))
 			{
-				value += getInt16(dataBuffer);
+				return emptyGlyphData;
 			}
+		}
+		if (numPoints == 0)
+		{
+			return emptyGlyphData;
+		}
 
-			xPoints[i] = value;
+		// Decode into scratch at the top of the arena, then slide the decoded arrays together and
+		// give back everything after them
+		ArenaMarker marker = getArenaMarker(arena);
+		GlyphScratch scratch = createGlyphScratch(numPoints, numContours, arena);
+		GlyphData glyphData = decodeGlyph(glyph, fontInfo, scratch);
+		if (glyphData.numPoints == 0)
+		{
+			rewindArena(arena, marker);
+			return emptyGlyphData;
 		}
 
-		// Now we are at y coords
-		value = 0;
-		for (uint16 i = 0; i < numPoints; i++)
+		glyphData = copyGlyphData(glyphData, (uint8*)glyphData.contourEnds);
+		rewindArena(arena, marker);
+		size_t bytes = getGlyphDataSize(glyphData);
+		uint8* memory = (uint8*)arenaAllocate(arena, bytes);
+		if (memory != (uint8*)glyphData.contourEnds)
 		{
-			uint16 flag = flagBuffer[i];
-			if (flag & Y_IS_BYTE)
-			{
-				if (flag & Y_DELTA)
-				{
-					value += getUint8(dataBuffer);
-				}
-				else
-				{
-					value -= getUint8(dataBuffer);
-				}
-			}
-			else if (~flag & Y_DELTA)
+			// The scratch spilled into a new block but the decoded glyph fits back in the old one
+			glyphData = copyGlyphData(glyphData, memory);
+		}
+		return glyphData;
+	}
+
+	GlyphData getGlyphData(const Glyph& glyph, const FontInfo& fontInfo)
+	{
+		// Decode into scratch sized for this glyph, then hand back copies the caller owns
+		const GlyphData* cached = getCachedCompositeGlyph(glyph, fontInfo);
+		GlyphData scratchData = emptyGlyphData;
+		GlyphScratch scratch = {};
+		if (cached)
+		{
+			scratchData = *cached;
+		}
+		else if (glyph.numberOfContours > 0)
+		{
+			int numPoints = getSimpleGlyphNumPoints(glyph, fontInfo);
+			if (numPoints == 0)
 			{
-				value += getInt16(dataBuffer);
+				return emptyGlyphData;
 			}
+			scratch = createGlyphScratch(numPoints, glyph.numberOfContours);
+			scratchData = decodeGlyph(glyph, fontInfo, scratch);
+		}
+		else if (glyph.numberOfContours < 0)
+		{
+			scratch = createGlyphScratch(fontInfo);
+			scratchData = decodeGlyph(glyph, fontInfo, scratch);
+		}
 
-			yPoints[i] = value;
+		if (scratchData.numPoints == 0)
+		{
+			freeGlyphScratch(scratch);
+			return emptyGlyphData;
 		}
 
-		adjustedNumPoints += glyph.numberOfContours;
-		int16* finalXPoints = (int16*)malloc(sizeof(int16) * adjustedNumPoints);
-		int16* finalYPoints = (int16*)malloc(sizeof(int16) * adjustedNumPoints);
-		uint16* finalFlags = (uint16*)malloc(sizeof(uint16) * adjustedNumPoints);
-		int currentIndex = 0;
-		uint16 contourBegin = 0;
-		uint16 c = 0;
-		for (int i = 0; i < numPoints; i++)
+		GlyphData glyphData;
+		glyphData.numContours = scratchData.numContours;
+		glyphData.numPoints = scratchData.numPoints;
+		glyphData.contourEnds = (uint16*)allocate(sizeof(uint16) * glyphData.numContours);
+		glyphData.flags = (uint16*)allocate(sizeof(uint16) * glyphData.numPoints);
+		glyphData.xCoords = (int16*)allocate(sizeof(int16) * glyphData.numPoints);
+		glyphData.yCoords = (int16*)allocate(sizeof(int16) * glyphData.numPoints);
+		memcpy(glyphData.contourEnds, scratchData.contourEnds, sizeof(uint16) * glyphData.numContours);
+		memcpy(glyphData.flags, scratchData.flags, sizeof(uint16) * glyphData.numPoints);
+		memcpy(glyphData.xCoords, scratchData.xCoords, sizeof(int16) * glyphData.numPoints);
+		memcpy(glyphData.yCoords, scratchData.yCoords, sizeof(int16) * glyphData.numPoints);
+
+		freeGlyphScratch(scratch);
+		return glyphData;
+	}
+
+	// Flattens every composite glyph once into the font's arena
+	static void cacheCompositeGlyphs(FontInfo& fontInfo)
+	{
+		fontInfo.compositeArena = createArena();
+		GlyphData* compositeGlyphs = (GlyphData*)allocate(sizeof(GlyphData) * fontInfo.numGlyphs);
+		GlyphScratch scratch = createGlyphScratch(fontInfo);
+		for (int i = 0; i < fontInfo.numGlyphs; i++)
 		{
-			// Two off points, generate in between on points
-			if (i < numPoints - 1 && !(flagBuffer[i] & ON_CURVE) && !(flagBuffer[i + 1] & ON_CURVE))
-			{
-				finalXPoints[currentIndex] = xPoints[i];
-				finalYPoints[currentIndex] = yPoints[i];
-				finalFlags[currentIndex] = false;
-				currentIndex++;
-				// While off curve, copy new points in
-				while (i <= contourEnds[c] && !(flagBuffer[i] & ON_CURVE) && !(flagBuffer[i + 1] & ON_CURVE))
-				{
-					finalXPoints[currentIndex] = (xPoints[i] + xPoints[i + 1]) / 2;
-					finalYPoints[currentIndex] = (yPoints[i] + yPoints[i + 1]) / 2;
-					finalFlags[currentIndex] = 1;
-					currentIndex++;
-					finalXPoints[currentIndex] = xPoints[i + 1];
-					finalYPoints[currentIndex] = yPoints[i + 1];
-					finalFlags[currentIndex] = 0;
-					currentIndex++;
-					i++;
-				}
-			}
-			else
+			compositeGlyphs[i] = emptyGlyphData;
+			Glyph glyph = getGlyphById(i, fontInfo);
+			if (glyph.numberOfContours >= 0)
 			{
-				finalXPoints[currentIndex] = xPoints[i];
-				finalYPoints[currentIndex] = yPoints[i];
-				finalFlags[currentIndex] = flagBuffer[i] & ON_CURVE ? 1 : 0;
-				currentIndex++;
+				continue;
 			}
 
-			if (i >= contourEnds[c])
+			GlyphData glyphData = decodeGlyph(glyph, fontInfo, scratch);
+			if (glyphData.numPoints > 0)
 			{
-				// If we're at the end of a contour, add one extra point to connect the last point to the first point
-				finalXPoints[currentIndex] = finalXPoints[contourBegin];
-				finalYPoints[currentIndex] = finalYPoints[contourBegin];
-				finalFlags[currentIndex] = finalFlags[contourBegin];
-				contourEnds[c] = currentIndex;
-				contourBegin = currentIndex + 1;
-				currentIndex++;
-				c++;
+				uint8* memory = (uint8*)arenaAllocate(fontInfo.compositeArena, getGlyphDataSize(glyphData));
+				compositeGlyphs[i] = copyGlyphData(glyphData, memory);
 			}
 		}
+		freeGlyphScratch(scratch);
 
-		free(flagBuffer);
-		free(xPoints);
-		free(yPoints);
-
-		return {
-			glyph.numberOfContours,
-			contourEnds,
-			adjustedNumPoints,
-			finalFlags,
-			finalXPoints,
-			finalYPoints
-		};
+		fontInfo.compositeGlyphs = compositeGlyphs;
 	}
 
 	void freeGlyphData(GlyphData& glyph)
 	{
-		free(glyph.contourEnds);
-		free(glyph.flags);
-		free(glyph.xCoords);
-		free(glyph.yCoords);
+		deallocate(glyph.contourEnds);
+		deallocate(glyph.flags);
+		deallocate(glyph.xCoords);
+		deallocate(glyph.yCoords);
 	}
 
-	void drawCompositeGlyph(const Glyph& glyph)
+	void drawCompositeGlyph(const Glyph& glyph, const FontInfo& fontInfo, const char* fileLocation)
 	{
-		printf("Composite!\n");
+		// getGlyphData flattens the components into the same outline format a simple glyph has
+		drawSimpleGlyph(glyph, fontInfo, fileLocation);
 	}
 
-	void drawGlyph(uint16 codepoint, const FontInfo& fontInfo, const char* fileLocation = "glyph.png")
+	void drawGlyph(uint32 codepoint, const FontInfo& fontInfo, const char* fileLocation = "glyph.png")
 	{
 		Glyph glyph = getGlyph(codepoint, fontInfo);
 		if (glyph.simpleGlyphTable != nullptr)
@@ -519,35 +1412,122 @@ namespace Truetype
 		}
 		else if (glyph.compositeGlyphTable != nullptr)
 		{
-			drawCompositeGlyph(glyph);
+			drawCompositeGlyph(glyph, fontInfo, fileLocation);
 		}
-		else
+		// Otherwise the glyph is empty and there is nothing to draw
+	}
+
+	int getNumFonts(const char* fontData, int fontSize)
+	{
+		uint8* data = (uint8*)fontData;
+		if (fontSize < 12)
+		{
+			return 0;
+		}
+		if (tagEquals(data, "ttcf"))
 		{
-			TTF_ASSERT(0);
+			// The collection header is followed by an offset per font
+			uint32 numFonts = toULong(data + 8);
+			uint32 maxFonts = (uint32)(fontSize - 12) / 4;
+			return (int)(numFonts < maxFonts ? numFonts : maxFonts);
 		}
+		return 1;
 	}
 
-	void initFont(FontInfo& fontInfo, char* fontData, int fontSize)
+	// Where the font's table directory starts. Collections point at one per font, single fonts start with theirs.
+	// Returns -1 if the file has no font at that index or its directory runs past the end.
+	static int getFontStart(const char* fontData, int fontSize, int fontIndex)
+	{
+		uint8* data = (uint8*)fontData;
+		if (fontIndex < 0 || fontIndex >= getNumFonts(fontData, fontSize))
+		{
+			return -1;
+		}
+
+		uint32 fontStart = tagEquals(data, "ttcf") ? toULong(data + 12 + fontIndex * 4) : 0;
+		if ((uint64)fontStart + 12 > (uint64)fontSize ||
+			(uint64)fontStart + 12 + (uint64)toUShort(data + fontStart + 4) * 16 > (uint64)fontSize)
+		{
+			return -1;
+		}
+		return (int)fontStart;
+	}
+
+	bool initFont(FontInfo& fontInfo, char* fontData, int fontSize, uint32 initFlags, int fontIndex)
 	{
 		uint8* data = (uint8*)fontData;
 		fontInfo.data = fontData;
 		fontInfo.fontSize = fontSize;
+		fontInfo.loadMode = FontLoadMode::Copy;
+		fontInfo.mapping = { nullptr, 0, nullptr, nullptr };
+		fontInfo.cmapSegments = nullptr;
+		fontInfo.numCmapSegments = 0;
+		fontInfo.cmapGroups = nullptr;
+		fontInfo.numCmapGroups = 0;
+		fontInfo.glyphPages = nullptr;
+		fontInfo.numGlyphPages = 0;
+		fontInfo.glyphOffsets = nullptr;
+		fontInfo.compositeGlyphs = nullptr;
+		fontInfo.compositeArena = createArena();
+		fontInfo.horizontalMetrics = nullptr;
+		fontInfo.kernKeys = nullptr;
+		fontInfo.numKernPairs = 0;
+		fontInfo.kernShift = 32;
+		fontInfo.gposLookups = nullptr;
+		fontInfo.numGposLookups = 0;
+		fontInfo.gposArena = createArena(16 * 1024);
+
+		fontInfo.fontStart = getFontStart(fontData, fontSize, fontIndex);
+		if (fontInfo.fontStart < 0)
+		{
+			printf("Font file has no font at index %d.\n", fontIndex);
+			return false;
+		}
 
-		int numTables = toUShort(data + 4);
-		fontInfo.fontStart = 12 + numTables * 16;
+		indexTables(fontInfo);
+		fontInfo.loca = getTable(fontInfo, TableType::Loca).offset;
+		fontInfo.head = getTable(fontInfo, TableType::Head).offset;
+		fontInfo.glyf = getTable(fontInfo, TableType::Glyf).offset;
+		fontInfo.hhea = getTable(fontInfo, TableType::Hhea).offset;
+		fontInfo.hmtx = getTable(fontInfo, TableType::Hmtx).offset;
+		fontInfo.kern = getTable(fontInfo, TableType::Kern).offset;
+		fontInfo.gpos = getTable(fontInfo, TableType::Gpos).offset;
+		fontInfo.svg = getTable(fontInfo, TableType::Svg).offset;
+
+		if (!hasTable(fontInfo, TableType::Cmap) || !hasTable(fontInfo, TableType::Head) || !hasTable(fontInfo, TableType::Maxp) ||
+			!hasTable(fontInfo, TableType::Loca) || !hasTable(fontInfo, TableType::Glyf))
+		{
+			printf("Font is missing one of the required tables 'cmap', 'head', 'maxp', 'loca' or 'glyf'.\n");
+			return false;
+		}
 
-		fontInfo.loca = findTableOffset(fontData, "loca");
-		fontInfo.head = findTableOffset(fontData, "head");
-		fontInfo.glyf = findTableOffset(fontData, "glyf");
-		fontInfo.hhea = findTableOffset(fontData, "hhea");
-		fontInfo.hmtx = findTableOffset(fontData, "hmtx");
-		fontInfo.kern = findTableOffset(fontData, "kern");
-		fontInfo.gpos = findTableOffset(fontData, "gpos");
-		fontInfo.svg = findTableOffset(fontData, "svg ");
+		// Everything read out of head and maxp below has to be inside the tables
+		if (getTable(fontInfo, TableType::Head).length < 54 || getTable(fontInfo, TableType::Maxp).length < 6)
+		{
+			printf("Font has a 'head' or 'maxp' table that is too short.\n");
+			return false;
+		}
 
-		// TODO: This table may not exist in some font formats
-		uint32 maxpTable = findTableOffset(fontData, "maxp");
-		fontInfo.numGlyphs = toUShort(data + maxpTable + 4);
+		const TableRecord& maxpTable = getTable(fontInfo, TableType::Maxp);
+		fontInfo.numGlyphs = toUShort(data + maxpTable.offset + 4);
+
+		// Version 1.0 has the sizes of the largest glyphs, version 0.5 (CFF fonts) stops after numGlyphs
+		fontInfo.maxPoints = 0;
+		fontInfo.maxContours = 0;
+		fontInfo.maxCompositePoints = 0;
+		fontInfo.maxCompositeContours = 0;
+		fontInfo.maxComponentElements = 0;
+		fontInfo.maxComponentDepth = 0;
+		bool hasGlyphMaxima = toULong(data + maxpTable.offset) == 0x00010000 && maxpTable.length >= 32;
+		if (hasGlyphMaxima)
+		{
+			fontInfo.maxPoints = toUShort(data + maxpTable.offset + 6);
+			fontInfo.maxContours = toUShort(data + maxpTable.offset + 8);
+			fontInfo.maxCompositePoints = toUShort(data + maxpTable.offset + 10);
+			fontInfo.maxCompositeContours = toUShort(data + maxpTable.offset + 12);
+			fontInfo.maxComponentElements = toUShort(data + maxpTable.offset + 28);
+			fontInfo.maxComponentDepth = toUShort(data + maxpTable.offset + 30);
+		}
 
 		// Get font information from the head table
 		Buffer headTableBuffer = getBuffer(data + fontInfo.head, fontInfo);
@@ -562,32 +1542,163 @@ namespace Truetype
 		skip(headTableBuffer, 6);
 		fontInfo.indexToLocFormat = getInt16(headTableBuffer);
 
+		// Every glyph needs its own loca offset and the one after it. Glyphs past the end of loca are dropped, so
+		// nothing that reads loca has to check the glyph id against the table again.
+		uint32 locaEntrySize = fontInfo.indexToLocFormat == 0 ? 2 : 4;
+		uint32 numLocaEntries = getTable(fontInfo, TableType::Loca).length / locaEntrySize;
+		if (numLocaEntries < (uint32)fontInfo.numGlyphs + 1)
+		{
+			int numGlyphs = numLocaEntries > 0 ? (int)numLocaEntries - 1 : 0;
+			printf("Loca table only has room for %d of %d glyphs.\n", numGlyphs, fontInfo.numGlyphs);
+			fontInfo.numGlyphs = numGlyphs;
+		}
+
+		if (initFlags & INIT_DECODE_LOCA)
+		{
+			decodeLoca(fontInfo);
+		}
+		if (!hasGlyphMaxima)
+		{
+			// Scratch decoding is sized from these, so without them every glyph would come back empty
+			findGlyphMaxima(fontInfo);
+		}
+		initHorizontalMetrics(fontInfo, (initFlags & INIT_DECODE_HMTX) != 0);
+		initKerning(fontInfo);
+		initGposKerning(fontInfo);
+
 		// Find an appropriate cmap table for a version we would like to use
-		uint32 cmapTableOffset = findTableOffset(fontData, "cmap");
+		uint32 cmapTableOffset = getTable(fontInfo, TableType::Cmap).offset;
 
 		uint16 cmapVersion = toUShort(data + cmapTableOffset);
 		TTF_ASSERT(cmapVersion == 0);
 		uint16 cmapNumTables = toUShort(data + cmapTableOffset + 2);
-		uint32 cmapRecordOffset = -1;
+		// Prefer a full unicode subtable (format 12) so codepoints outside the BMP can be mapped, otherwise use the
+		// first unicode BMP subtable. Format 13 maps whole ranges to one last resort glyph, so it is only used
+		// when there is nothing else.
+		uint32 bmpSubtable = 0;
+		uint32 fullSubtable = 0;
+		uint32 lastResortSubtable = 0;
 		for (int i = 0; i < cmapNumTables; i++)
 		{
 			uint16 recordPlatformId = toUShort(data + cmapTableOffset + 4 + i * 8);
 			uint16 recordEncodingId = toUShort(data + cmapTableOffset + 6 + i * 8);
 			bool isWindowsPlatform = recordPlatformId == 3 && (recordEncodingId == 0 || recordEncodingId == 1 || recordEncodingId == 10);
-			bool isUnicodePlatform = recordPlatformId == 0 && recordEncodingId >= 0 && recordEncodingId <= 4;
+			bool isUnicodePlatform = recordPlatformId == 0 && recordEncodingId >= 0 && recordEncodingId <= 6;
+			if (!isWindowsPlatform && !isUnicodePlatform)
+			{
+				continue;
+			}
+
+			uint32 subtableOffset = cmapTableOffset + toULong(data + cmapTableOffset + 8 + i * 8);
+			if (subtableOffset + 16 > (uint32)fontSize)
+			{
+				continue;
+			}
+
+			uint16 format = toUShort(data + subtableOffset);
+			if (format == 4 && bmpSubtable == 0)
+			{
+				bmpSubtable = subtableOffset;
+			}
+			else if (format == 12 && fullSubtable == 0)
+			{
+				fullSubtable = subtableOffset;
+			}
+			else if (format == 13 && lastResortSubtable == 0)
+			{
+				lastResortSubtable = subtableOffset;
+			}
+		}
+
+		fontInfo.cmap = fullSubtable != 0 ? fullSubtable : bmpSubtable;
+		if (fontInfo.cmap == 0)
+		{
+			fontInfo.cmap = lastResortSubtable;
+		}
+		fontInfo.cmapFormat = fontInfo.cmap != 0 ? toUShort(data + fontInfo.cmap) : 0;
+		if (fontInfo.cmapFormat == 4)
+		{
+			decodeCmapFormat4(fontInfo);
+		}
+		else if (fontInfo.cmapFormat == 12 || fontInfo.cmapFormat == 13)
+		{
+			decodeCmapFormat12(fontInfo);
+		}
+		else
+		{
+			printf("No supported unicode cmap subtable found.\n");
+		}
+		buildGlyphPages(fontInfo, (initFlags & INIT_GLYPH_PAGE_TABLE) != 0);
+
+		if (initFlags & INIT_CACHE_COMPOSITES)
+		{
+			cacheCompositeGlyphs(fontInfo);
+		}
+
+		return true;
+	}
+
+	bool loadFont(FontInfo& fontInfo, const char* filepath, FontLoadMode mode, uint32 initFlags, int fontIndex)
+	{
+		MappedFile file = mode == FontLoadMode::MemoryMap ? mapFile(filepath) : readFileCopy(filepath);
+		if (!file.data)
+		{
+			return false;
+		}
 
-			if (isWindowsPlatform || isUnicodePlatform)
+		bool initialized = initFont(fontInfo, file.data, (int)file.size, initFlags, fontIndex);
+		if (mode == FontLoadMode::MemoryMap)
+		{
+			fontInfo.loadMode = FontLoadMode::MemoryMap;
+			fontInfo.mapping = file;
+		}
+
+		if (!initialized)
+		{
+			freeFont(fontInfo);
+		}
+		return initialized;
+	}
+
+	size_t getFontMemoryUsage(const FontInfo& fontInfo)
+	{
+		size_t bytes = sizeof(CmapSegment) * fontInfo.numCmapSegments + sizeof(CmapGroup) * fontInfo.numCmapGroups;
+		if (fontInfo.glyphPages)
+		{
+			bytes += sizeof(uint16*) * fontInfo.numGlyphPages;
+			// Page 0 is latin1Page, which lives inside FontInfo
+			for (int i = 1; i < fontInfo.numGlyphPages; i++)
 			{
-				uint32 subtableOffset = toULong(data + cmapTableOffset + 8 + i * 8);
-				fontInfo.cmap = cmapTableOffset + subtableOffset;
-				break;
+				if (fontInfo.glyphPages[i])
+				{
+					bytes += sizeof(uint16) * 256;
+				}
 			}
 		}
+		if (fontInfo.glyphOffsets)
+		{
+			bytes += sizeof(uint32) * (fontInfo.numGlyphs + 1);
+		}
+		if (fontInfo.compositeGlyphs)
+		{
+			bytes += sizeof(GlyphData) * fontInfo.numGlyphs + fontInfo.compositeArena.bytesReserved;
+		}
+		if (fontInfo.horizontalMetrics)
+		{
+			bytes += sizeof(HorizontalMetrics) * fontInfo.numGlyphs;
+		}
+		if (fontInfo.kernKeys)
+		{
+			bytes += (sizeof(uint32) + sizeof(int16)) * ((size_t)(0xFFFFFFFFu >> fontInfo.kernShift) + 1);
+		}
+		bytes += fontInfo.gposArena.bytesReserved;
+		return bytes;
 	}
 
 	bool checkCompatibility(FontInfo& fontInfo)
 	{
 		Buffer buffer = getBuffer((uint8*)fontInfo.data, fontInfo.fontSize);
+		skip(buffer, fontInfo.fontStart);
 
 		uint32 sfntVersion = getUint32(buffer);
 		if (sfntVersion != 0x00010000)
@@ -598,81 +1709,166 @@ namespace Truetype
 		return true;
 	}
 
-	uint32 writeInternalFont(FontInfo& fontInfo, const char* fontToWrite)
+	// A run of glyph records for writeInternalFont, with each glyph's offset relative to the start of the run
+	struct InternalFontChunk
 	{
-		if (!checkCompatibility(fontInfo))
-		{
-			printf("Incompatible font.\n");
-			return 0;
-		}
+		uint8* data;
+		size_t size;
+		size_t capacity;
+		uint32* glyphOffsets;
+	};
 
-		uint64 fontSize = 1024 * 1024 * 1024;// fontInfo.fontSize * 5;
-		uint8* writeBufferPtr = (uint8*)malloc(sizeof(uint8) * fontSize);
-		Buffer writeBuffer = getBuffer(writeBufferPtr, fontSize);
-		uint32 numGlyphs = fontInfo.numGlyphs + 1;
-		writeUint32(writeBuffer, numGlyphs);
-		for (uint16 c = 0; c <= fontInfo.numGlyphs; c++)
+	static uint8* reserveChunkBytes(InternalFontChunk& chunk, size_t numBytes)
+	{
+		if (chunk.size + numBytes > chunk.capacity)
 		{
-			writeUint32(writeBuffer, c);
+			size_t capacity = chunk.capacity * 2 > chunk.size + numBytes ? chunk.capacity * 2 : chunk.size + numBytes;
+			uint8* data = (uint8*)allocate(capacity);
+			if (chunk.size > 0)
+			{
+				memcpy(data, chunk.data, chunk.size);
+			}
+			deallocate(chunk.data);
+			chunk.data = data;
+			chunk.capacity = capacity;
 		}
+		uint8* dst = chunk.data + chunk.size;
+		chunk.size += numBytes;
+		return dst;
+	}
 
-		for (uint16 c = 0; c <= fontInfo.numGlyphs; c++)
+	// Records are written in native byte order: numContours, contourEnds, numPoints, flags, x and y coordinates.
+	// Empty glyphs are a single 0.
+	static void writeInternalFontChunk(const FontInfo& fontInfo, int firstGlyph, int endGlyph, GlyphScratch& scratch, InternalFontChunk& chunk)
+	{
+		for (int c = firstGlyph; c < endGlyph; c++)
 		{
-			// Write the offset of this glyph to the appropriate index in the beginning of the file
-			uint32 currentPos = (uint32)writeBuffer.cursor;
-			Buffer writeBufferBegin = getBuffer(writeBufferPtr + 4, fontSize - 4);
-			seek(writeBufferBegin, c * 4);
-			writeUint32(writeBufferBegin, currentPos);
+			chunk.glyphOffsets[c - firstGlyph] = (uint32)chunk.size;
 
+			// Composite glyphs are written flattened, the same way as simple ones
 			Glyph glyph = getGlyph(c, fontInfo);
-			if (glyph.simpleGlyphTable == nullptr)
+			GlyphData glyphData = getGlyphData(glyph, fontInfo, scratch);
+			if (glyphData.numPoints == 0)
 			{
-				writeUint16(writeBuffer, 0);
+				uint16 empty = 0;
+				memcpy(reserveChunkBytes(chunk, sizeof(uint16)), &empty, sizeof(uint16));
 				continue;
 			}
 
-			if (glyph.numberOfContours == 0)
-			{
-				writeUint16(writeBuffer, 0);
-				continue;
-			}
+			size_t contourBytes = sizeof(uint16) * glyphData.numContours;
+			size_t pointBytes = sizeof(uint16) * glyphData.numPoints;
+			uint8* dst = reserveChunkBytes(chunk, sizeof(int16) + contourBytes + sizeof(uint16) + pointBytes * 3);
+			memcpy(dst, &glyphData.numContours, sizeof(int16));
+			dst += sizeof(int16);
+			memcpy(dst, glyphData.contourEnds, contourBytes);
+			dst += contourBytes;
+			memcpy(dst, &glyphData.numPoints, sizeof(uint16));
+			dst += sizeof(uint16);
+			memcpy(dst, glyphData.flags, pointBytes);
+			dst += pointBytes;
+			memcpy(dst, glyphData.xCoords, pointBytes);
+			dst += pointBytes;
+			memcpy(dst, glyphData.yCoords, pointBytes);
+		}
+	}
+
+	uint32 writeInternalFont(FontInfo& fontInfo, const char* fontToWrite, int numThreads)
+	{
+		if (!checkCompatibility(fontInfo))
+		{
+			printf("Incompatible font.\n");
+			return 0;
+		}
+
+		// Glyphs are split into chunks that the threads take in turn. Each chunk is encoded into its own buffer,
+		// then a prefix sum over the chunk sizes turns the offsets inside the chunks into file offsets.
+		const int glyphsPerChunk = 256;
+		int numEntries = fontInfo.numGlyphs + 1;
+		int numChunks = (numEntries + glyphsPerChunk - 1) / glyphsPerChunk;
+		InternalFontChunk* chunks = (InternalFontChunk*)allocate(sizeof(InternalFontChunk) * numChunks);
+		for (int i = 0; i < numChunks; i++)
+		{
+			chunks[i] = { nullptr, 0, 0, (uint32*)allocate(sizeof(uint32) * glyphsPerChunk) };
+		}
 
-			GlyphData glyphData = getGlyphData(glyph, fontInfo);
-			writeUint16(writeBuffer, glyphData.numContours);
+		if (numThreads <= 0)
+		{
+			numThreads = (int)std::thread::hardware_concurrency();
+		}
+		numThreads = numThreads < 1 ? 1 : (numThreads > numChunks ? numChunks : numThreads);
 
-			for (int i = 0; i < glyphData.numContours; i++)
+		std::atomic<int> nextChunk(0);
+		auto writeChunks = [&]()
+		{
+			GlyphScratch scratch = createGlyphScratch(fontInfo);
+			for (int i = nextChunk++; i < numChunks; i = nextChunk++)
 			{
-				writeUint16(writeBuffer, glyphData.contourEnds[i]);
+				int firstGlyph = i * glyphsPerChunk;
+				int endGlyph = firstGlyph + glyphsPerChunk < numEntries ? firstGlyph + glyphsPerChunk : numEntries;
+				writeInternalFontChunk(fontInfo, firstGlyph, endGlyph, scratch, chunks[i]);
 			}
+			freeGlyphScratch(scratch);
+		};
 
-			writeUint16(writeBuffer, glyphData.numPoints);
-			for (int i = 0; i < glyphData.numPoints; i++)
+		if (numThreads == 1)
+		{
+			writeChunks();
+		}
+		else
+		{
+			std::thread* threads = new std::thread[numThreads - 1];
+			for (int i = 0; i < numThreads - 1; i++)
 			{
-				writeUint16(writeBuffer, glyphData.flags[i]);
+				threads[i] = std::thread(writeChunks);
 			}
-
-			for (int i = 0; i < glyphData.numPoints; i++)
+			writeChunks();
+			for (int i = 0; i < numThreads - 1; i++)
 			{
-				writeInt16(writeBuffer, glyphData.xCoords[i]);
+				threads[i].join();
 			}
+			delete[] threads;
+		}
 
-			for (int i = 0; i < glyphData.numPoints; i++)
+		// The header is the number of glyphs followed by the file offset of each glyph
+		uint32 headerSize = sizeof(uint32) * (numEntries + 1);
+		uint32* header = (uint32*)allocate(headerSize);
+		header[0] = (uint32)numEntries;
+		uint32 chunkStart = headerSize;
+		for (int i = 0; i < numChunks; i++)
+		{
+			int numChunkGlyphs = (i + 1) * glyphsPerChunk < numEntries ? glyphsPerChunk : numEntries - i * glyphsPerChunk;
+			for (int g = 0; g < numChunkGlyphs; g++)
 			{
-				writeInt16(writeBuffer, glyphData.yCoords[i]);
+				header[1 + i * glyphsPerChunk + g] = chunkStart + chunks[i].glyphOffsets[g];
 			}
-
-			freeGlyphData(glyphData);
+			chunkStart += (uint32)chunks[i].size;
 		}
 
 		// Write font file
 		FILE* writeFile = fopen(fontToWrite, "wb");
-		fwrite(writeBufferPtr, sizeof(uint8) * writeBuffer.cursor, 1, writeFile);
-		fclose(writeFile);
+		if (writeFile)
+		{
+			fwrite(header, headerSize, 1, writeFile);
+			for (int i = 0; i < numChunks; i++)
+			{
+				fwrite(chunks[i].data, chunks[i].size, 1, writeFile);
+			}
+			fclose(writeFile);
+		}
+		else
+		{
+			printf("Unable to open '%s' for writing.\n", fontToWrite);
+		}
 
-		// Free write buffer
-		free(writeBufferPtr);
+		deallocate(header);
+		for (int i = 0; i < numChunks; i++)
+		{
+			deallocate(chunks[i].data);
+			deallocate(chunks[i].glyphOffsets);
+		}
+		deallocate(chunks);
 
-		return writeBuffer.cursor / 4;
+		return writeFile ? chunkStart / 4 : 0;
 	}
 
 	void parseFont(FontInfo& fontInfo)
@@ -682,7 +1878,54 @@ namespace Truetype
 
 	void freeFont(FontInfo& font)
 	{
+		deallocate(font.cmapSegments);
+		font.cmapSegments = nullptr;
+		font.numCmapSegments = 0;
+		deallocate(font.cmapGroups);
+		font.cmapGroups = nullptr;
+		font.numCmapGroups = 0;
+
+		if (font.glyphPages)
+		{
+			// glyphPages[0] is always nullptr, page 0 is latin1Page
+			for (int i = 1; i < font.numGlyphPages; i++)
+			{
+				deallocate(font.glyphPages[i]);
+			}
+			deallocate(font.glyphPages);
+			font.glyphPages = nullptr;
+			font.numGlyphPages = 0;
+		}
+
+		deallocate(font.glyphOffsets);
+		font.glyphOffsets = nullptr;
+
+		deallocate(font.compositeGlyphs);
+		font.compositeGlyphs = nullptr;
+		freeArena(font.compositeArena);
+
+		deallocate(font.horizontalMetrics);
+		font.horizontalMetrics = nullptr;
+
+		// The values share the keys' allocation
+		deallocate(font.kernKeys);
+		font.kernKeys = nullptr;
+		font.kernValues = nullptr;
+		font.numKernPairs = 0;
+
+		freeArena(font.gposArena);
+		font.gposLookups = nullptr;
+		font.numGposLookups = 0;
+
 		// Free file
-		free(font.data);
+		if (font.loadMode == FontLoadMode::MemoryMap)
+		{
+			unmapFile(font.mapping);
+		}
+		else
+		{
+			free(font.data);
+		}
+		font.data = nullptr;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include "glyphCache.h"
+#include "glyph.h"
+
+#include <mutex>
+#include <new>
+
+namespace Truetype
+{
+	// Allocated in one block with the outline arrays right after it
+	struct GlyphCacheEntry
+	{
+		const char* font;
+		uint32 glyphId;
+		uint64 hash;
+		size_t bytes;
+
+		GlyphCacheEntry* hashNext;
+		GlyphCacheEntry* lruPrev; // Towards the most recently used entry
+		GlyphCacheEntry* lruNext; // Towards the least recently used entry
+
+		GlyphData glyphData;
+	};
+
+	struct GlyphCacheShard
+	{
+		std::mutex mutex;
+		GlyphCacheEntry** buckets;
+		uint32 bucketMask;
+		GlyphCacheEntry* lruHead;
+		GlyphCacheEntry* lruTail;
+
+		size_t bytesUsed;
+		size_t byteBudget;
+		int numEntries;
+		uint64 hits;
+		uint64 misses;
+		uint64 evictions;
+	};
+
+	struct GlyphCache
+	{
+		GlyphCacheShard* shards;
+		uint32 shardMask;
+		size_t byteBudget;
+	};
+
+	static uint64 hashGlyphKey(const char* font, uint32 glyphId)
+	{
+		uint64 hash = ((uint64)(uintptr_t)font ^ ((uint64)glyphId << 32 | glyphId)) * 0x9E3779B97F4A7C15ull;
+		return hash ^ (hash >> 29);
+	}
+
+	static uint32 roundUpToPowerOfTwo(uint32 value)
+	{
+		uint32 result = 1;
+		while (result < value)
+		{
+			result <<= 1;
+		}
+		return result;
+	}
+
+	GlyphCache* createGlyphCache(size_t byteBudget, int numShards)
+	{
+		uint32 shardCount = roundUpToPowerOfTwo(numShards > 0 ? (uint32)numShards : 1);
+		GlyphCache* cache = (GlyphCache*)allocate(sizeof(GlyphCache));
+		cache->shards = (GlyphCacheShard*)allocate(sizeof(GlyphCacheShard) * shardCount);
+		cache->shardMask = shardCount - 1;
+		cache->byteBudget = byteBudget;
+
+		// Size the hash tables for outlines of around 256 bytes, the size of a typical Latin glyph
+		size_t shardBudget = byteBudget / shardCount;
+		uint32 bucketCount = roundUpToPowerOfTwo((uint32)(shardBudget / 256 > 16 ? shardBudget / 256 : 16));
+		for (uint32 i = 0; i < shardCount; i++)
+		{
+			GlyphCacheShard* shard = new (&cache->shards[i]) GlyphCacheShard;
+			shard->buckets = (GlyphCacheEntry**)allocateZeroed(sizeof(GlyphCacheEntry*) * bucketCount);
+			shard->bucketMask = bucketCount - 1;
+			shard->lruHead = nullptr;
+			shard->lruTail = nullptr;
+			shard->bytesUsed = 0;
+			shard->byteBudget = shardBudget;
+			shard->numEntries = 0;
+			shard->hits = 0;
+			shard->misses = 0;
+			shard->evictions = 0;
+		}
+		return cache;
+	}
+
+	static void unlinkLru(GlyphCacheShard& shard, GlyphCacheEntry* entry)
+	{
+		if (entry->lruPrev)
+		{
+			entry->lruPrev->lruNext = entry->lruNext;
+		}
+		else
+		{
+			shard.lruHead = entry->lruNext;
+		}
+
+		if (entry->lruNext)
+		{
+			entry->lruNext->lruPrev = entry->lruPrev;
+		}
+		else
+		{
+			shard.lruTail = entry->lruPrev;
+		}
+	}
+
+	static void pushLruHead(GlyphCacheShard& shard, GlyphCacheEntry* entry)
+	{
+		entry->lruPrev = nullptr;
+		entry->lruNext = shard.lruHead;
+		if (shard.lruHead)
+		{
+			shard.lruHead->lruPrev = entry;
+		}
+		else
+		{
+			shard.lruTail = entry;
+		}
+		shard.lruHead = entry;
+	}
+
+	static void removeEntry(GlyphCacheShard& shard, GlyphCacheEntry* entry)
+	{
+		GlyphCacheEntry** link = &shard.buckets[entry->hash & shard.bucketMask];
+		while (*link != entry)
+		{
+			link = &(*link)->hashNext;
+		}
+		*link = entry->hashNext;
+
+		unlinkLru(shard, entry);
+		shard.bytesUsed -= entry->bytes;
+		shard.numEntries--;
+		deallocate(entry);
+	}
+
+	static GlyphCacheEntry* findEntry(GlyphCacheShard& shard, uint64 hash, const char* font, uint32 glyphId)
+	{
+		GlyphCacheEntry* entry = shard.buckets[hash & shard.bucketMask];
+		while (entry && (entry->font != font || entry->glyphId != glyphId))
+		{
+			entry = entry->hashNext;
+		}
+		return entry;
+	}
+
+	static bool copyIntoScratch(const GlyphData& glyphData, GlyphScratch& scratch, GlyphData& result)
+	{
+		if (glyphData.numContours > scratch.contourCapacity || glyphData.numPoints > scratch.outputCapacity)
+		{
+			return false;
+		}
+
+		memcpy(scratch.contourEnds, glyphData.contourEnds, sizeof(uint16) * glyphData.numContours);
+		memcpy(scratch.flags, glyphData.flags, sizeof(uint16) * glyphData.numPoints);
+		memcpy(scratch.xCoords, glyphData.xCoords, sizeof(int16) * glyphData.numPoints);
+		memcpy(scratch.yCoords, glyphData.yCoords, sizeof(int16) * glyphData.numPoints);
+		result = {
+			glyphData.numContours,
+			scratch.contourEnds,
+			glyphData.numPoints,
+			scratch.flags,
+			scratch.xCoords,
+			scratch.yCoords
+		};
+		return true;
+	}
+
+	static GlyphCacheEntry* createEntry(const GlyphData& glyphData, const char* font, uint32 glyphId, uint64 hash)
+	{
+		size_t arrayBytes = sizeof(uint16) * glyphData.numContours + (sizeof(uint16) + sizeof(int16) * 2) * glyphData.numPoints;
+		GlyphCacheEntry* entry = (GlyphCacheEntry*)allocate(sizeof(GlyphCacheEntry) + arrayBytes);
+		entry->font = font;
+		entry->glyphId = glyphId;
+		entry->hash = hash;
+		entry->bytes = sizeof(GlyphCacheEntry) + arrayBytes;
+
+		uint8* memory = (uint8*)(entry + 1);
+		GlyphData& copy = entry->glyphData;
+		copy.numContours = glyphData.numContours;
+		copy.numPoints = glyphData.numPoints;
+		copy.contourEnds = (uint16*)memory;
+		copy.flags = copy.contourEnds + copy.numContours;
+		copy.xCoords = (int16*)(copy.flags + copy.numPoints);
+		copy.yCoords = copy.xCoords + copy.numPoints;
+		memcpy(copy.contourEnds, glyphData.contourEnds, sizeof(uint16) * copy.numContours);
+		memcpy(copy.flags, glyphData.flags, sizeof(uint16) * copy.numPoints);
+		memcpy(copy.xCoords, glyphData.xCoords, sizeof(int16) * copy.numPoints);
+		memcpy(copy.yCoords, glyphData.yCoords, sizeof(int16) * copy.numPoints);
+		return entry;
+	}
+
+	// Fonts of a collection share their data, but each has its own table directory
+	static const char* getFontKey(const FontInfo& fontInfo)
+	{
+		return fontInfo.data + fontInfo.fontStart;
+	}
+
+	GlyphData getGlyphData(GlyphCache& cache, const Glyph& glyph, const FontInfo& fontInfo, GlyphScratch& scratch)
+	{
+		const char* font = getFontKey(fontInfo);
+		uint64 hash = hashGlyphKey(font, glyph.id);
+		GlyphCacheShard& shard = cache.shards[(hash >> 48) & cache.shardMask];
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			GlyphCacheEntry* entry = findEntry(shard, hash, font, glyph.id);
+			if (entry)
+			{
+				GlyphData result;
+				if (copyIntoScratch(entry->glyphData, scratch, result))
+				{
+					shard.hits++;
+					unlinkLru(shard, entry);
+					pushLruHead(shard, entry);
+					return result;
+				}
+			}
+			shard.misses++;
+		}
+
+		// Decode outside the lock, another thread may decode the same glyph at the same time
+		GlyphData glyphData = getGlyphData(glyph, fontInfo, scratch);
+		GlyphCacheEntry* entry = createEntry(glyphData, font, glyph.id, hash);
+		if (entry->bytes > shard.byteBudget)
+		{
+			deallocate(entry);
+			return glyphData;
+		}
+
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		if (findEntry(shard, hash, font, glyph.id))
+		{
+			deallocate(entry);
+			return glyphData;
+		}
+
+		while (shard.lruTail && shard.bytesUsed + entry->bytes > shard.byteBudget)
+		{
+			removeEntry(shard, shard.lruTail);
+			shard.evictions++;
+		}
+
+		GlyphCacheEntry*& bucket = shard.buckets[hash & shard.bucketMask];
+		entry->hashNext = bucket;
+		bucket = entry;
+		pushLruHead(shard, entry);
+		shard.bytesUsed += entry->bytes;
+		shard.numEntries++;
+		return glyphData;
+	}
+
+	void evictFont(GlyphCache& cache, const FontInfo& fontInfo)
+	{
+		for (uint32 i = 0; i <= cache.shardMask; i++)
+		{
+			GlyphCacheShard& shard = cache.shards[i];
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			GlyphCacheEntry* entry = shard.lruHead;
+			while (entry)
+			{
+				GlyphCacheEntry* next = entry->lruNext;
+				if (entry->font == getFontKey(fontInfo))
+				{
+					removeEntry(shard, entry);
+				}
+				entry = next;
+			}
+		}
+	}
+
+	GlyphCacheStats getGlyphCacheStats(GlyphCache& cache)
+	{
+		GlyphCacheStats stats = { 0, 0, 0, 0, cache.byteBudget, 0 };
+		for (uint32 i = 0; i <= cache.shardMask; i++)
+		{
+			GlyphCacheShard& shard = cache.shards[i];
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			stats.hits += shard.hits;
+			stats.misses += shard.misses;
+			stats.evictions += shard.evictions;
+			stats.bytesUsed += shard.bytesUsed;
+			stats.numEntries += shard.numEntries;
+		}
+		return stats;
+	}
+
+	void freeGlyphCache(GlyphCache* cache)
+	{
+		if (!cache)
+		{
+			return;
+		}
+
+		for (uint32 i = 0; i <= cache->shardMask; i++)
+		{
+			GlyphCacheShard& shard = cache->shards[i];
+			GlyphCacheEntry* entry = shard.lruHead;
+			while (entry)
+			{
+				GlyphCacheEntry* next = entry->lruNext;
+				deallocate(entry);
+				entry = next;
+			}
+			deallocate(shard.buckets);
+			shard.~GlyphCacheShard();
+		}
+		deallocate(cache->shards);
+		deallocate(cache);
+	}
+}
@@ -0,0 +1,197 @@
+#include "memory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace Truetype
+{
+	static void* defaultAllocate(size_t numBytes, void*)
+	{
+		return malloc(numBytes);
+	}
+
+	static void defaultDeallocate(void* memory, void*)
+	{
+		free(memory);
+	}
+
+	static AllocateFn g_allocate = defaultAllocate;
+	static DeallocateFn g_deallocate = defaultDeallocate;
+	static void* g_allocatorUserdata = nullptr;
+
+	void setAllocator(AllocateFn allocateFn, DeallocateFn deallocateFn, void* userdata)
+	{
+		g_allocate = allocateFn ? allocateFn : defaultAllocate;
+		g_deallocate = deallocateFn ? deallocateFn : defaultDeallocate;
+		g_allocatorUserdata = userdata;
+	}
+
+	void* allocate(size_t numBytes)
+	{
+		return g_allocate(numBytes, g_allocatorUserdata);
+	}
+
+	void* allocateZeroed(size_t numBytes)
+	{
+		void* memory = allocate(numBytes);
+		if (memory)
+		{
+			memset(memory, 0, numBytes);
+		}
+		return memory;
+	}
+
+	void deallocate(void* memory)
+	{
+		if (memory)
+		{
+			g_deallocate(memory, g_allocatorUserdata);
+		}
+	}
+
+	static size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	static uint8* getBlockData(ArenaBlock* block)
+	{
+		return (uint8*)block + alignUp(sizeof(ArenaBlock), 16);
+	}
+
+	static ArenaBlock* createArenaBlock(Arena& arena, size_t size)
+	{
+		ArenaBlock* block = (ArenaBlock*)allocate(alignUp(sizeof(ArenaBlock), 16) + size);
+		if (!block)
+		{
+			return nullptr;
+		}
+
+		block->next = nullptr;
+		block->size = size;
+		block->used = 0;
+		arena.bytesReserved += size;
+		arena.numBlocks++;
+		return block;
+	}
+
+	Arena createArena(size_t blockSize)
+	{
+		Arena arena;
+		arena.first = nullptr;
+		arena.current = nullptr;
+		arena.blockSize = blockSize;
+		arena.bytesUsed = 0;
+		arena.bytesReserved = 0;
+		arena.peakBytesUsed = 0;
+		arena.numBlocks = 0;
+		arena.numBlocksUsed = 0;
+		arena.peakBlocksUsed = 0;
+		arena.numAllocations = 0;
+		return arena;
+	}
+
+	void* arenaAllocate(Arena& arena, size_t numBytes, size_t alignment)
+	{
+		TTF_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= 16);
+
+		ArenaBlock* block = arena.current;
+		size_t offset = block ? alignUp(block->used, alignment) : 0;
+		if (!block || offset + numBytes > block->size)
+		{
+			// Move on to the next block. Blocks left over from before a reset are reused if they are big enough,
+			// otherwise a new one goes in after the current block
+			ArenaBlock* next = block ? block->next : arena.first;
+			if (!next || numBytes > next->size)
+			{
+				size_t size = numBytes > arena.blockSize ? numBytes : arena.blockSize;
+				ArenaBlock* newBlock = createArenaBlock(arena, size);
+				if (!newBlock)
+				{
+					return nullptr;
+				}
+
+				newBlock->next = next;
+				if (block)
+				{
+					block->next = newBlock;
+				}
+				else
+				{
+					arena.first = newBlock;
+				}
+				next = newBlock;
+			}
+
+			// The waste at the end of the previous block counts as used so rewinding stays exact
+			if (block)
+			{
+				arena.bytesUsed += block->size - block->used;
+				block->used = block->size;
+			}
+
+			block = next;
+			block->used = 0;
+			arena.current = block;
+			arena.numBlocksUsed++;
+			if (arena.numBlocksUsed > arena.peakBlocksUsed)
+			{
+				arena.peakBlocksUsed = arena.numBlocksUsed;
+			}
+			offset = 0;
+		}
+
+		arena.bytesUsed += offset + numBytes - block->used;
+		block->used = offset + numBytes;
+		if (arena.bytesUsed > arena.peakBytesUsed)
+		{
+			arena.peakBytesUsed = arena.bytesUsed;
+		}
+		arena.numAllocations++;
+		return getBlockData(block) + offset;
+	}
+
+	ArenaMarker getArenaMarker(const Arena& arena)
+	{
+		return {
+			arena.current,
+			arena.current ? arena.current->used : 0,
+			arena.bytesUsed,
+			arena.numBlocksUsed
+		};
+	}
+
+	void rewindArena(Arena& arena, const ArenaMarker& marker)
+	{
+		if (!marker.block)
+		{
+			resetArena(arena);
+			return;
+		}
+
+		arena.current = marker.block;
+		arena.current->used = marker.blockUsed;
+		arena.bytesUsed = marker.bytesUsed;
+		arena.numBlocksUsed = marker.numBlocksUsed;
+	}
+
+	void resetArena(Arena& arena)
+	{
+		arena.current = nullptr;
+		arena.bytesUsed = 0;
+		arena.numBlocksUsed = 0;
+	}
+
+	void freeArena(Arena& arena)
+	{
+		ArenaBlock* block = arena.first;
+		while (block)
+		{
+			ArenaBlock* next = block->next;
+			deallocate(block);
+			block = next;
+		}
+
+		arena = createArena(arena.blockSize);
+	}
+}
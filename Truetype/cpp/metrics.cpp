@@ -0,0 +1,811 @@
+#include "metrics.h"
+#include "glyph.h"
+
+#include <algorithm>
+
+namespace Truetype
+{
+	// The number of long metrics that actually fit in hmtx, so reads never run past the table
+	static int getNumLongMetrics(const FontInfo& fontInfo)
+	{
+		uint32 hmtxLength = getTable(fontInfo, TableType::Hmtx).length;
+		int numLongMetrics = fontInfo.numberOfHMetrics;
+		if ((uint32)numLongMetrics * 4 > hmtxLength)
+		{
+			numLongMetrics = (int)(hmtxLength / 4);
+		}
+		return numLongMetrics;
+	}
+
+	static HorizontalMetrics readHorizontalMetrics(uint32 glyphId, const FontInfo& fontInfo)
+	{
+		HorizontalMetrics metrics = { 0, 0 };
+		int numLongMetrics = getNumLongMetrics(fontInfo);
+		if (numLongMetrics == 0 || glyphId >= (uint32)fontInfo.numGlyphs)
+		{
+			return metrics;
+		}
+
+		const uint8* hmtx = (const uint8*)fontInfo.data + fontInfo.hmtx;
+		if (glyphId < (uint32)numLongMetrics)
+		{
+			metrics.advanceWidth = loadUint16(hmtx + glyphId * 4);
+			metrics.leftSideBearing = loadInt16(hmtx + glyphId * 4 + 2);
+			return metrics;
+		}
+
+		// Monospaced runs at the end of the font only store their lsb, after the long metrics
+		metrics.advanceWidth = loadUint16(hmtx + (numLongMetrics - 1) * 4);
+		uint32 lsbOffset = numLongMetrics * 4 + (glyphId - numLongMetrics) * 2;
+		if (lsbOffset + 2 <= getTable(fontInfo, TableType::Hmtx).length)
+		{
+			metrics.leftSideBearing = loadInt16(hmtx + lsbOffset);
+		}
+		return metrics;
+	}
+
+	static void decodeHorizontalMetrics(FontInfo& fontInfo)
+	{
+		int numLongMetrics = getNumLongMetrics(fontInfo);
+		if (numLongMetrics == 0)
+		{
+			return;
+		}
+
+		const uint8* hmtx = (const uint8*)fontInfo.data + fontInfo.hmtx;
+		uint32 hmtxLength = getTable(fontInfo, TableType::Hmtx).length;
+		HorizontalMetrics* metrics = (HorizontalMetrics*)allocate(sizeof(HorizontalMetrics) * fontInfo.numGlyphs);
+		for (int glyphId = 0; glyphId < numLongMetrics; glyphId++)
+		{
+			metrics[glyphId].advanceWidth = loadUint16(hmtx + glyphId * 4);
+			metrics[glyphId].leftSideBearing = loadInt16(hmtx + glyphId * 4 + 2);
+		}
+
+		uint16 lastAdvance = metrics[numLongMetrics - 1].advanceWidth;
+		for (int glyphId = numLongMetrics; glyphId < fontInfo.numGlyphs; glyphId++)
+		{
+			uint32 lsbOffset = numLongMetrics * 4 + (glyphId - numLongMetrics) * 2;
+			metrics[glyphId].advanceWidth = lastAdvance;
+			metrics[glyphId].leftSideBearing = lsbOffset + 2 <= hmtxLength ? loadInt16(hmtx + lsbOffset) : 0;
+		}
+		fontInfo.horizontalMetrics = metrics;
+	}
+
+	void initHorizontalMetrics(FontInfo& fontInfo, bool decodeHmtx)
+	{
+		fontInfo.ascender = 0;
+		fontInfo.descender = 0;
+		fontInfo.lineGap = 0;
+		fontInfo.advanceWidthMax = 0;
+		fontInfo.numberOfHMetrics = 0;
+		fontInfo.horizontalMetrics = nullptr;
+
+		const TableRecord& hheaTable = getTable(fontInfo, TableType::Hhea);
+		if (hheaTable.length < 36)
+		{
+			return;
+		}
+
+		const uint8* hhea = (const uint8*)fontInfo.data + hheaTable.offset;
+		fontInfo.ascender = loadInt16(hhea + 4);
+		fontInfo.descender = loadInt16(hhea + 6);
+		fontInfo.lineGap = loadInt16(hhea + 8);
+		fontInfo.advanceWidthMax = loadUint16(hhea + 10);
+		if (hasTable(fontInfo, TableType::Hmtx))
+		{
+			int numberOfHMetrics = loadUint16(hhea + 34);
+			fontInfo.numberOfHMetrics = numberOfHMetrics < fontInfo.numGlyphs ? numberOfHMetrics : fontInfo.numGlyphs;
+		}
+
+		if (decodeHmtx)
+		{
+			decodeHorizontalMetrics(fontInfo);
+		}
+	}
+
+	HorizontalMetrics getHorizontalMetrics(uint32 glyphId, const FontInfo& fontInfo)
+	{
+		if (fontInfo.horizontalMetrics)
+		{
+			if (glyphId < (uint32)fontInfo.numGlyphs)
+			{
+				return fontInfo.horizontalMetrics[glyphId];
+			}
+			return { 0, 0 };
+		}
+		return readHorizontalMetrics(glyphId, fontInfo);
+	}
+
+	// kern subtable coverage bits. The format is in the high byte.
+	static const uint16 KERN_HORIZONTAL = 0x0001;
+	static const uint16 KERN_MINIMUM = 0x0002;
+	static const uint16 KERN_CROSS_STREAM = 0x0004;
+	static const uint16 KERN_OVERRIDE = 0x0008;
+
+	// Plain horizontal kerning, the only kind that applies to a run laid out left to right
+	static bool isKernPairSubtable(uint16 coverage)
+	{
+		return (coverage >> 8) == 0 && (coverage & (KERN_HORIZONTAL | KERN_MINIMUM | KERN_CROSS_STREAM)) == KERN_HORIZONTAL;
+	}
+
+	// Never a real pair since glyph ids stop at 0xFFFE. Empty slots have a value of 0, so looking it up is harmless.
+	static const uint32 EMPTY_KERN_SLOT = 0xFFFFFFFF;
+
+	static inline uint32 getPairSlot(uint32 key, int shift)
+	{
+		return (key * 0x9E3779B1u) >> shift;
+	}
+
+	// The slot holding the pair, or the empty slot where it would go
+	static inline uint32 findPairSlot(const uint32* keys, int shift, uint32 key)
+	{
+		uint32 mask = 0xFFFFFFFFu >> shift;
+		uint32 slot = getPairSlot(key, shift);
+		while (keys[slot] != key && keys[slot] != EMPTY_KERN_SLOT)
+		{
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	// Open addressing at most half full, so most pairs are found with one probe and most misses stop at once
+	static int getPairHashBits(int numPairs)
+	{
+		int numBits = 1;
+		while ((1 << numBits) < numPairs * 2)
+		{
+			numBits++;
+		}
+		return numBits;
+	}
+
+	void initKerning(FontInfo& fontInfo)
+	{
+		fontInfo.kernKeys = nullptr;
+		fontInfo.kernValues = nullptr;
+		fontInfo.numKernPairs = 0;
+		fontInfo.kernShift = 32;
+
+		// Version 0 is the Microsoft format. Apple's version 1 starts with a 32 bit version and isn't supported.
+		const TableRecord& kernTable = getTable(fontInfo, TableType::Kern);
+		const uint8* kern = (const uint8*)fontInfo.data + kernTable.offset;
+		if (kernTable.length < 4 || loadUint16(kern) != 0)
+		{
+			return;
+		}
+
+		// Find the subtables to use and how many pairs they have
+		const int maxSubtables = 64;
+		uint32 subtableOffsets[maxSubtables];
+		int numSubtables = 0;
+		int numPairs = 0;
+		int numTables = loadUint16(kern + 2);
+		uint32 offset = 4;
+		for (int t = 0; t < numTables && numSubtables < maxSubtables && offset + 14 <= kernTable.length; t++)
+		{
+			const uint8* subtable = kern + offset;
+			uint16 coverage = loadUint16(subtable + 4);
+			uint32 subtableLength = loadUint16(subtable + 2);
+			if ((coverage >> 8) == 0)
+			{
+				// The length field overflows for subtables of more than 10920 pairs, so go by the pair count
+				subtableLength = 14 + loadUint16(subtable + 6) * 6;
+			}
+			if (subtableLength < 6 || offset + subtableLength > kernTable.length)
+			{
+				break;
+			}
+
+			if (isKernPairSubtable(coverage))
+			{
+				subtableOffsets[numSubtables++] = offset;
+				numPairs += loadUint16(subtable + 6);
+			}
+			offset += subtableLength;
+		}
+
+		if (numPairs == 0)
+		{
+			return;
+		}
+
+		// Sort by pair, then by where the pair came from so later subtables add to or override earlier ones.
+		// The low bit of the order marks pairs from override subtables.
+		uint64* order = (uint64*)allocate(sizeof(uint64) * numPairs);
+		int16* pairValues = (int16*)allocate(sizeof(int16) * numPairs);
+		int numRead = 0;
+		for (int t = 0; t < numSubtables; t++)
+		{
+			const uint8* subtable = kern + subtableOffsets[t];
+			uint64 isOverride = (loadUint16(subtable + 4) & KERN_OVERRIDE) ? 1 : 0;
+			int subtablePairs = loadUint16(subtable + 6);
+			const uint8* pairs = subtable + 14;
+			for (int p = 0; p < subtablePairs; p++)
+			{
+				uint64 key = loadUint32(pairs + p * 6);
+				order[numRead] = (key << 32) | ((uint64)numRead << 1) | isOverride;
+				pairValues[numRead] = loadInt16(pairs + p * 6 + 4);
+				numRead++;
+			}
+		}
+		std::sort(order, order + numPairs);
+
+		uint32* sortedKeys = (uint32*)allocate(sizeof(uint32) * numPairs);
+		int16* sortedValues = (int16*)allocate(sizeof(int16) * numPairs);
+		int numUnique = 0;
+		for (int i = 0; i < numPairs; i++)
+		{
+			uint32 key = (uint32)(order[i] >> 32);
+			int16 value = pairValues[(uint32)order[i] >> 1];
+			if (key == EMPTY_KERN_SLOT)
+			{
+				// Glyph 0xFFFF can't exist, and the key would read as an empty slot holding a value
+				continue;
+			}
+			if (numUnique > 0 && sortedKeys[numUnique - 1] == key)
+			{
+				sortedValues[numUnique - 1] = (order[i] & 1) ? value : (int16)(sortedValues[numUnique - 1] + value);
+				continue;
+			}
+			sortedKeys[numUnique] = key;
+			sortedValues[numUnique] = value;
+			numUnique++;
+		}
+
+		int numBits = getPairHashBits(numUnique);
+		uint32 numSlots = 1u << numBits;
+		uint8* memory = (uint8*)allocate((sizeof(uint32) + sizeof(int16)) * numSlots);
+		fontInfo.kernKeys = (uint32*)memory;
+		fontInfo.kernValues = (int16*)(fontInfo.kernKeys + numSlots);
+		fontInfo.kernShift = 32 - numBits;
+		fontInfo.numKernPairs = numUnique;
+		memset(fontInfo.kernKeys, 0xFF, sizeof(uint32) * numSlots);
+		memset(fontInfo.kernValues, 0, sizeof(int16) * numSlots);
+		for (int i = 0; i < numUnique; i++)
+		{
+			uint32 slot = findPairSlot(fontInfo.kernKeys, fontInfo.kernShift, sortedKeys[i]);
+			fontInfo.kernKeys[slot] = sortedKeys[i];
+			fontInfo.kernValues[slot] = sortedValues[i];
+		}
+
+		deallocate(sortedValues);
+		deallocate(sortedKeys);
+		deallocate(pairValues);
+		deallocate(order);
+	}
+
+	static inline int16 findKernPair(uint32 key, const FontInfo& fontInfo)
+	{
+		return fontInfo.kernValues[findPairSlot(fontInfo.kernKeys, fontInfo.kernShift, key)];
+	}
+
+	// Bounds checked reads from the GPOS table, offsets are from its start
+	struct GposTable
+	{
+		const uint8* data;
+		uint32 length;
+	};
+
+	static inline bool canReadGpos(const GposTable& gpos, uint32 offset, uint32 numBytes)
+	{
+		return offset <= gpos.length && numBytes <= gpos.length - offset;
+	}
+
+	static inline uint16 readGposUint16(const GposTable& gpos, uint32 offset)
+	{
+		return loadUint16(gpos.data + offset);
+	}
+
+	// Calls coverageFn(glyph, coverageIndex) for every glyph of a coverage table. Returns false if it can't be read.
+	template <typename CoverageFn>
+	static bool forEachCoveredGlyph(const GposTable& gpos, uint32 offset, CoverageFn coverageFn)
+	{
+		if (!canReadGpos(gpos, offset, 4))
+		{
+			return false;
+		}
+
+		uint16 format = readGposUint16(gpos, offset);
+		uint16 count = readGposUint16(gpos, offset + 2);
+		if (format == 1 && canReadGpos(gpos, offset + 4, count * 2))
+		{
+			for (int i = 0; i < count; i++)
+			{
+				coverageFn(readGposUint16(gpos, offset + 4 + i * 2), i);
+			}
+			return true;
+		}
+		if (format == 2 && canReadGpos(gpos, offset + 4, count * 6))
+		{
+			for (int r = 0; r < count; r++)
+			{
+				uint32 range = offset + 4 + r * 6;
+				uint16 startGlyph = readGposUint16(gpos, range);
+				uint16 endGlyph = readGposUint16(gpos, range + 2);
+				uint16 startIndex = readGposUint16(gpos, range + 4);
+				for (uint32 glyph = startGlyph; glyph <= endGlyph; glyph++)
+				{
+					coverageFn((uint16)glyph, startIndex + (int)(glyph - startGlyph));
+				}
+			}
+			return true;
+		}
+		return false;
+	}
+
+	// Calls classFn(glyph, class) for every glyph a class definition table lists
+	template <typename ClassFn>
+	static bool forEachGlyphClass(const GposTable& gpos, uint32 offset, ClassFn classFn)
+	{
+		if (!canReadGpos(gpos, offset, 4))
+		{
+			return false;
+		}
+
+		uint16 format = readGposUint16(gpos, offset);
+		if (format == 1 && canReadGpos(gpos, offset, 6))
+		{
+			uint16 startGlyph = readGposUint16(gpos, offset + 2);
+			uint16 count = readGposUint16(gpos, offset + 4);
+			if (!canReadGpos(gpos, offset + 6, count * 2))
+			{
+				return false;
+			}
+			for (uint32 i = 0; i < count && startGlyph + i <= 0xFFFF; i++)
+			{
+				classFn((uint16)(startGlyph + i), readGposUint16(gpos, offset + 6 + i * 2));
+			}
+			return true;
+		}
+		if (format == 2)
+		{
+			uint16 count = readGposUint16(gpos, offset + 2);
+			if (!canReadGpos(gpos, offset + 4, count * 6))
+			{
+				return false;
+			}
+			for (int r = 0; r < count; r++)
+			{
+				uint32 range = offset + 4 + r * 6;
+				uint16 startGlyph = readGposUint16(gpos, range);
+				uint16 endGlyph = readGposUint16(gpos, range + 2);
+				uint16 glyphClass = readGposUint16(gpos, range + 4);
+				for (uint32 glyph = startGlyph; glyph <= endGlyph; glyph++)
+				{
+					classFn((uint16)glyph, glyphClass);
+				}
+			}
+			return true;
+		}
+		return false;
+	}
+
+	// Value records hold one int16 for every bit set in the low byte of their format, x advance being the third
+	static int getValueRecordSize(uint16 valueFormat)
+	{
+		int size = 0;
+		for (int bit = 0; bit < 8; bit++)
+		{
+			size += (valueFormat >> bit) & 1;
+		}
+		return size * 2;
+	}
+
+	static int getXAdvanceOffset(uint16 valueFormat)
+	{
+		if (!(valueFormat & 0x0004))
+		{
+			return -1;
+		}
+		return getValueRecordSize(valueFormat & 0x0003);
+	}
+
+	// Adds the pairs of a PairPos format 1 subtable to the lookup's hash table. Pairs already in it came from an
+	// earlier subtable and win.
+	static void addPairSetPairs(const GposTable& gpos, uint32 subtable, int subtableIndex, GposPairLookup& lookup, bool countOnly)
+	{
+		if (!canReadGpos(gpos, subtable, 10))
+		{
+			return;
+		}
+
+		uint16 valueFormat1 = readGposUint16(gpos, subtable + 4);
+		uint16 valueFormat2 = readGposUint16(gpos, subtable + 6);
+		uint16 pairSetCount = readGposUint16(gpos, subtable + 8);
+		if (!canReadGpos(gpos, subtable + 10, pairSetCount * 2))
+		{
+			return;
+		}
+
+		int recordSize = 2 + getValueRecordSize(valueFormat1) + getValueRecordSize(valueFormat2);
+		int xAdvanceOffset = getXAdvanceOffset(valueFormat1);
+		uint32 coverage = subtable + readGposUint16(gpos, subtable + 2);
+		forEachCoveredGlyph(gpos, coverage, [&](uint16 firstGlyph, int coverageIndex)
+		{
+			if (coverageIndex >= pairSetCount)
+			{
+				return;
+			}
+			uint32 pairSet = subtable + readGposUint16(gpos, subtable + 10 + coverageIndex * 2);
+			if (!canReadGpos(gpos, pairSet, 2))
+			{
+				return;
+			}
+			uint16 pairValueCount = readGposUint16(gpos, pairSet);
+			if (!canReadGpos(gpos, pairSet + 2, pairValueCount * recordSize))
+			{
+				return;
+			}
+
+			if (countOnly)
+			{
+				lookup.numPairs += pairValueCount;
+				return;
+			}
+
+			for (int p = 0; p < pairValueCount; p++)
+			{
+				uint32 record = pairSet + 2 + p * recordSize;
+				uint32 key = ((uint32)firstGlyph << 16) | readGposUint16(gpos, record);
+				uint32 slot = findPairSlot(lookup.pairKeys, lookup.pairShift, key);
+				if (key == EMPTY_KERN_SLOT || lookup.pairKeys[slot] == key)
+				{
+					continue;
+				}
+				lookup.pairKeys[slot] = key;
+				lookup.pairValues[slot] = xAdvanceOffset >= 0 ? loadInt16(gpos.data + record + 2 + xAdvanceOffset) : 0;
+				lookup.pairSubtables[slot] = (uint16)subtableIndex;
+			}
+		});
+	}
+
+	// Flattens a PairPos format 2 subtable into dense class arrays and a class by class matrix.
+	// Returns false if the subtable can't be read.
+	static bool buildClassSubtable(const GposTable& gpos, uint32 subtable, int subtableIndex, GposClassSubtable& result, Arena& arena)
+	{
+		if (!canReadGpos(gpos, subtable, 16))
+		{
+			return false;
+		}
+
+		uint16 valueFormat1 = readGposUint16(gpos, subtable + 4);
+		uint16 valueFormat2 = readGposUint16(gpos, subtable + 6);
+		uint32 classDef1 = subtable + readGposUint16(gpos, subtable + 8);
+		uint32 classDef2 = subtable + readGposUint16(gpos, subtable + 10);
+		int class1Count = readGposUint16(gpos, subtable + 12);
+		int class2Count = readGposUint16(gpos, subtable + 14);
+		int recordSize = getValueRecordSize(valueFormat1) + getValueRecordSize(valueFormat2);
+		// Up to 65535 x 65535 records, so the matrix size doesn't fit in an int. Once it fits in the table the class
+		// counts multiply without overflowing. A matrix without value records adjusts nothing and isn't kept.
+		uint64 matrixSize = (uint64)class1Count * (uint64)class2Count * (uint64)recordSize;
+		if (matrixSize == 0 || matrixSize > gpos.length || !canReadGpos(gpos, subtable + 16, (uint32)matrixSize))
+		{
+			return false;
+		}
+
+		// The first glyph's class array spans the coverage table, so it also answers whether the subtable applies
+		uint32 coverage = subtable + readGposUint16(gpos, subtable + 2);
+		uint32 firstGlyph = 0xFFFF;
+		uint32 lastGlyph = 0;
+		bool readable = forEachCoveredGlyph(gpos, coverage, [&](uint16 glyph, int)
+		{
+			firstGlyph = glyph < firstGlyph ? glyph : firstGlyph;
+			lastGlyph = glyph > lastGlyph ? glyph : lastGlyph;
+		});
+		if (!readable || firstGlyph > lastGlyph)
+		{
+			return false;
+		}
+
+		result.subtableIndex = subtableIndex;
+		result.firstGlyph = (uint16)firstGlyph;
+		result.numGlyphs = (uint16)(lastGlyph - firstGlyph + 1);
+		result.class1 = (uint16*)arenaAllocate(arena, sizeof(uint16) * result.numGlyphs, alignof(uint16));
+		memset(result.class1, 0xFF, sizeof(uint16) * result.numGlyphs);
+		forEachCoveredGlyph(gpos, coverage, [&](uint16 glyph, int)
+		{
+			result.class1[glyph - firstGlyph] = 0;
+		});
+		// Glyphs missing from a class definition are in class 0, and so are classes past the end of the matrix
+		forEachGlyphClass(gpos, classDef1, [&](uint16 glyph, uint16 glyphClass)
+		{
+			uint32 i = (uint32)glyph - firstGlyph;
+			if (i < result.numGlyphs && result.class1[i] != GPOS_NOT_COVERED)
+			{
+				result.class1[i] = glyphClass < class1Count ? glyphClass : 0;
+			}
+		});
+
+		uint32 firstClass2Glyph = 0xFFFF;
+		uint32 lastClass2Glyph = 0;
+		forEachGlyphClass(gpos, classDef2, [&](uint16 glyph, uint16 glyphClass)
+		{
+			if (glyphClass != 0)
+			{
+				firstClass2Glyph = glyph < firstClass2Glyph ? glyph : firstClass2Glyph;
+				lastClass2Glyph = glyph > lastClass2Glyph ? glyph : lastClass2Glyph;
+			}
+		});
+		result.firstClass2Glyph = 0;
+		result.numClass2Glyphs = 0;
+		result.class2 = nullptr;
+		if (firstClass2Glyph <= lastClass2Glyph)
+		{
+			result.firstClass2Glyph = (uint16)firstClass2Glyph;
+			result.numClass2Glyphs = (uint16)(lastClass2Glyph - firstClass2Glyph + 1);
+			result.class2 = (uint16*)arenaAllocate(arena, sizeof(uint16) * result.numClass2Glyphs, alignof(uint16));
+			memset(result.class2, 0, sizeof(uint16) * result.numClass2Glyphs);
+			forEachGlyphClass(gpos, classDef2, [&](uint16 glyph, uint16 glyphClass)
+			{
+				uint32 i = (uint32)glyph - firstClass2Glyph;
+				if (i < result.numClass2Glyphs)
+				{
+					result.class2[i] = glyphClass < class2Count ? glyphClass : 0;
+				}
+			});
+		}
+
+		result.class2Count = class2Count;
+		result.values = (int16*)arenaAllocate(arena, sizeof(int16) * class1Count * class2Count, alignof(int16));
+		int xAdvanceOffset = getXAdvanceOffset(valueFormat1);
+		for (int i = 0; i < class1Count * class2Count; i++)
+		{
+			result.values[i] = xAdvanceOffset >= 0 ? loadInt16(gpos.data + subtable + 16 + i * recordSize + xAdvanceOffset) : 0;
+		}
+		return true;
+	}
+
+	static const uint16 GPOS_PAIR_ADJUSTMENT = 2;
+	static const uint16 GPOS_EXTENSION = 9;
+
+	// Finds the PairPos subtables of a lookup, looking through extension subtables. Returns how many there are.
+	static int findPairPosSubtables(const GposTable& gpos, uint32 lookupTable, uint32* subtables)
+	{
+		uint16 lookupType = readGposUint16(gpos, lookupTable);
+		uint16 subtableCount = readGposUint16(gpos, lookupTable + 4);
+		int numSubtables = 0;
+		for (int i = 0; i < subtableCount; i++)
+		{
+			uint32 subtable = lookupTable + readGposUint16(gpos, lookupTable + 6 + i * 2);
+			uint16 subtableType = lookupType;
+			if (lookupType == GPOS_EXTENSION)
+			{
+				if (!canReadGpos(gpos, subtable, 8) || readGposUint16(gpos, subtable) != 1)
+				{
+					continue;
+				}
+				subtableType = readGposUint16(gpos, subtable + 2);
+				subtable += loadUint32(gpos.data + subtable + 4);
+			}
+
+			if (subtableType == GPOS_PAIR_ADJUSTMENT && canReadGpos(gpos, subtable, 2))
+			{
+				subtables[numSubtables++] = subtable;
+			}
+		}
+		return numSubtables;
+	}
+
+	static void buildPairLookup(const GposTable& gpos, const uint32* subtables, int numSubtables, GposPairLookup& lookup, Arena& arena)
+	{
+		lookup.numPairs = 0;
+		lookup.numClassSubtables = 0;
+		for (int i = 0; i < numSubtables; i++)
+		{
+			uint16 format = readGposUint16(gpos, subtables[i]);
+			if (format == 1)
+			{
+				addPairSetPairs(gpos, subtables[i], i, lookup, true);
+			}
+			else if (format == 2)
+			{
+				lookup.numClassSubtables++;
+			}
+		}
+
+		// Sized for every pair record, duplicates included
+		int numBits = getPairHashBits(lookup.numPairs > 0 ? lookup.numPairs : 1);
+		uint32 numSlots = 1u << numBits;
+		lookup.pairShift = 32 - numBits;
+		lookup.pairKeys = (uint32*)arenaAllocate(arena, sizeof(uint32) * numSlots, alignof(uint32));
+		lookup.pairValues = (int16*)arenaAllocate(arena, sizeof(int16) * numSlots, alignof(int16));
+		lookup.pairSubtables = (uint16*)arenaAllocate(arena, sizeof(uint16) * numSlots, alignof(uint16));
+		memset(lookup.pairKeys, 0xFF, sizeof(uint32) * numSlots);
+		memset(lookup.pairValues, 0, sizeof(int16) * numSlots);
+		memset(lookup.pairSubtables, 0xFF, sizeof(uint16) * numSlots);
+
+		lookup.classSubtables = (GposClassSubtable*)arenaAllocate(arena, sizeof(GposClassSubtable) * lookup.numClassSubtables, alignof(GposClassSubtable));
+		lookup.numClassSubtables = 0;
+		for (int i = 0; i < numSubtables; i++)
+		{
+			uint16 format = readGposUint16(gpos, subtables[i]);
+			if (format == 1)
+			{
+				addPairSetPairs(gpos, subtables[i], i, lookup, false);
+			}
+			else if (format == 2 && buildClassSubtable(gpos, subtables[i], i, lookup.classSubtables[lookup.numClassSubtables], arena))
+			{
+				lookup.numClassSubtables++;
+			}
+		}
+	}
+
+	void initGposKerning(FontInfo& fontInfo)
+	{
+		const TableRecord& gposTable = getTable(fontInfo, TableType::Gpos);
+		GposTable gpos = { (const uint8*)fontInfo.data + gposTable.offset, gposTable.length };
+		if (!canReadGpos(gpos, 0, 10) || readGposUint16(gpos, 0) != 1)
+		{
+			return;
+		}
+
+		uint32 featureList = readGposUint16(gpos, 6);
+		uint32 lookupList = readGposUint16(gpos, 8);
+		if (!canReadGpos(gpos, featureList, 2) || !canReadGpos(gpos, lookupList, 2))
+		{
+			return;
+		}
+		uint16 featureCount = readGposUint16(gpos, featureList);
+		uint16 lookupCount = readGposUint16(gpos, lookupList);
+		if (!canReadGpos(gpos, featureList + 2, featureCount * 6) || !canReadGpos(gpos, lookupList + 2, lookupCount * 2))
+		{
+			return;
+		}
+
+		// Kerning is whatever the 'kern' feature of any script uses
+		uint8* usedLookups = (uint8*)allocateZeroed(lookupCount > 0 ? lookupCount : 1);
+		for (int f = 0; f < featureCount; f++)
+		{
+			uint32 record = featureList + 2 + f * 6;
+			if (!tagEquals((uint8*)gpos.data + record, 'k', 'e', 'r', 'n'))
+			{
+				continue;
+			}
+			uint32 feature = featureList + readGposUint16(gpos, record + 4);
+			if (!canReadGpos(gpos, feature, 4))
+			{
+				continue;
+			}
+			uint16 lookupIndexCount = readGposUint16(gpos, feature + 2);
+			if (!canReadGpos(gpos, feature + 4, lookupIndexCount * 2))
+			{
+				continue;
+			}
+			for (int i = 0; i < lookupIndexCount; i++)
+			{
+				uint16 lookupIndex = readGposUint16(gpos, feature + 4 + i * 2);
+				if (lookupIndex < lookupCount)
+				{
+					usedLookups[lookupIndex] = 1;
+				}
+			}
+		}
+
+		int numUsedLookups = 0;
+		for (int l = 0; l < lookupCount; l++)
+		{
+			numUsedLookups += usedLookups[l];
+		}
+
+		if (numUsedLookups == 0)
+		{
+			deallocate(usedLookups);
+			return;
+		}
+
+		fontInfo.gposLookups = (GposPairLookup*)arenaAllocate(fontInfo.gposArena, sizeof(GposPairLookup) * numUsedLookups, alignof(GposPairLookup));
+		for (int l = 0; l < lookupCount; l++)
+		{
+			uint32 lookupTable = lookupList + readGposUint16(gpos, lookupList + 2 + l * 2);
+			if (!usedLookups[l] || !canReadGpos(gpos, lookupTable, 6))
+			{
+				continue;
+			}
+			uint16 subtableCount = readGposUint16(gpos, lookupTable + 4);
+			if (!canReadGpos(gpos, lookupTable + 6, subtableCount * 2))
+			{
+				continue;
+			}
+
+			uint32* subtables = (uint32*)allocate(sizeof(uint32) * (subtableCount > 0 ? subtableCount : 1));
+			int numSubtables = findPairPosSubtables(gpos, lookupTable, subtables);
+			if (numSubtables > 0)
+			{
+				buildPairLookup(gpos, subtables, numSubtables, fontInfo.gposLookups[fontInfo.numGposLookups++], fontInfo.gposArena);
+			}
+			deallocate(subtables);
+		}
+		deallocate(usedLookups);
+	}
+
+	// The first subtable of the lookup that applies to the pair decides its value. Format 1 subtables only apply
+	// if they have the pair, format 2 subtables apply to every pair whose first glyph they cover.
+	static inline int getLookupKerning(const GposPairLookup& lookup, uint16 left, uint16 right)
+	{
+		uint32 key = ((uint32)left << 16) | right;
+		uint32 slot = findPairSlot(lookup.pairKeys, lookup.pairShift, key);
+		int pairSubtable = lookup.pairKeys[slot] == key ? lookup.pairSubtables[slot] : 0x10000;
+		for (int i = 0; i < lookup.numClassSubtables; i++)
+		{
+			const GposClassSubtable& classSubtable = lookup.classSubtables[i];
+			if (classSubtable.subtableIndex > pairSubtable)
+			{
+				break;
+			}
+
+			uint32 glyph = (uint32)left - classSubtable.firstGlyph;
+			if (glyph < classSubtable.numGlyphs && classSubtable.class1[glyph] != GPOS_NOT_COVERED)
+			{
+				uint32 class2Glyph = (uint32)right - classSubtable.firstClass2Glyph;
+				int class2 = class2Glyph < classSubtable.numClass2Glyphs ? classSubtable.class2[class2Glyph] : 0;
+				return classSubtable.values[classSubtable.class1[glyph] * classSubtable.class2Count + class2];
+			}
+		}
+		return lookup.pairValues[slot];
+	}
+
+	static inline int getGposPairKerning(uint16 left, uint16 right, const FontInfo& fontInfo)
+	{
+		int kerning = 0;
+		for (int l = 0; l < fontInfo.numGposLookups; l++)
+		{
+			kerning += getLookupKerning(fontInfo.gposLookups[l], left, right);
+		}
+		return kerning;
+	}
+
+	int getGposKerning(uint32 leftGlyphId, uint32 rightGlyphId, const FontInfo& fontInfo)
+	{
+		if (leftGlyphId > 0xFFFF || rightGlyphId > 0xFFFF)
+		{
+			return 0;
+		}
+		return getGposPairKerning((uint16)leftGlyphId, (uint16)rightGlyphId, fontInfo);
+	}
+
+	int getKernTableKerning(uint32 leftGlyphId, uint32 rightGlyphId, const FontInfo& fontInfo)
+	{
+		if (fontInfo.numKernPairs == 0 || leftGlyphId > 0xFFFF || rightGlyphId > 0xFFFF)
+		{
+			return 0;
+		}
+		return findKernPair((leftGlyphId << 16) | rightGlyphId, fontInfo);
+	}
+
+	int getKerning(uint32 leftGlyphId, uint32 rightGlyphId, const FontInfo& fontInfo)
+	{
+		if (fontInfo.numGposLookups > 0)
+		{
+			return getGposKerning(leftGlyphId, rightGlyphId, fontInfo);
+		}
+		return getKernTableKerning(leftGlyphId, rightGlyphId, fontInfo);
+	}
+
+	void getKerning(const uint16* glyphIds, size_t count, int16* kerning, const FontInfo& fontInfo)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		if (fontInfo.numGposLookups > 0)
+		{
+			for (size_t i = 0; i + 1 < count; i++)
+			{
+				kerning[i] = (int16)getGposPairKerning(glyphIds[i], glyphIds[i + 1], fontInfo);
+			}
+		}
+		else if (fontInfo.numKernPairs > 0)
+		{
+			for (size_t i = 0; i + 1 < count; i++)
+			{
+				kerning[i] = findKernPair(((uint32)glyphIds[i] << 16) | glyphIds[i + 1], fontInfo);
+			}
+		}
+		else
+		{
+			memset(kerning, 0, sizeof(int16) * count);
+		}
+		kerning[count - 1] = 0;
+	}
+}
@@ -0,0 +1,633 @@
+#include "outline.h"
+#include "glyph.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace Truetype
+{
+	static const GlyphSegments emptyGlyphSegments = {
+		0,
+		nullptr,
+		0,
+		nullptr
+	};
+
+	// Contours start at their first on curve point. Decoded contours never have two off curve points in a row,
+	// so every off curve point is the control point of a quad between two on curve points. The closing point at
+	// the end of each contour repeats the first one and isn't needed for walking it as a loop.
+	static int findContourStart(const GlyphData& glyphData, int begin, int end)
+	{
+		for (int p = begin; p < end; p++)
+		{
+			if (glyphData.flags[p])
+			{
+				return p;
+			}
+		}
+		return -1;
+	}
+
+	// Calls segmentFn for every segment of the contour in points [begin, end) and returns how many there were
+	template <typename SegmentFn>
+	static int walkContour(const GlyphData& glyphData, int begin, int end, SegmentFn segmentFn)
+	{
+		int start = findContourStart(glyphData, begin, end);
+		if (start < 0)
+		{
+			return 0;
+		}
+
+		int numPoints = end - begin;
+		int numSegments = 0;
+		int offset = start - begin;
+		for (int i = 0; i < numPoints;)
+		{
+			int p0 = begin + (offset + i) % numPoints;
+			int p1 = begin + (offset + i + 1) % numPoints;
+			if (glyphData.flags[p1])
+			{
+				segmentFn(SegmentType::Line, p0, p0, p1);
+				i++;
+			}
+			else
+			{
+				int p2 = begin + (offset + i + 2) % numPoints;
+				segmentFn(SegmentType::Quad, p0, p1, p2);
+				i += 2;
+			}
+			numSegments++;
+		}
+		return numSegments;
+	}
+
+	int countGlyphSegments(const GlyphData& glyphData)
+	{
+		int numSegments = 0;
+		int begin = 0;
+		for (int c = 0; c < glyphData.numContours; c++)
+		{
+			int end = glyphData.contourEnds[c];
+			numSegments += walkContour(glyphData, begin, end, [](SegmentType, int, int, int) {});
+			begin = end + 1;
+		}
+		return numSegments;
+	}
+
+	static size_t getGlyphSegmentsSize(const GlyphData& glyphData, int numSegments)
+	{
+		return sizeof(Segment) * numSegments + sizeof(uint16) * glyphData.numContours;
+	}
+
+	// Segments first so they stay aligned, then the contour ends
+	static GlyphSegments writeGlyphSegments(const GlyphData& glyphData, int numSegments, uint8* memory)
+	{
+		GlyphSegments result;
+		result.numContours = glyphData.numContours;
+		result.numSegments = numSegments;
+		result.segments = (Segment*)memory;
+		result.contourEnds = (uint16*)(result.segments + numSegments);
+
+		Segment* segment = result.segments;
+		int begin = 0;
+		for (int c = 0; c < glyphData.numContours; c++)
+		{
+			int end = glyphData.contourEnds[c];
+			walkContour(glyphData, begin, end, [&](SegmentType type, int p0, int p1, int p2)
+			{
+				segment->type = type;
+				segment->x0 = glyphData.xCoords[p0];
+				segment->y0 = glyphData.yCoords[p0];
+				segment->cx = glyphData.xCoords[p1];
+				segment->cy = glyphData.yCoords[p1];
+				segment->x1 = glyphData.xCoords[p2];
+				segment->y1 = glyphData.yCoords[p2];
+				segment++;
+			});
+			result.contourEnds[c] = (uint16)(segment - result.segments);
+			begin = end + 1;
+		}
+		return result;
+	}
+
+	GlyphSegments getGlyphSegments(const GlyphData& glyphData)
+	{
+		if (glyphData.numPoints == 0)
+		{
+			return emptyGlyphSegments;
+		}
+
+		int numSegments = countGlyphSegments(glyphData);
+		uint8* memory = (uint8*)allocate(getGlyphSegmentsSize(glyphData, numSegments));
+		return writeGlyphSegments(glyphData, numSegments, memory);
+	}
+
+	GlyphSegments getGlyphSegments(const GlyphData& glyphData, Arena& arena)
+	{
+		if (glyphData.numPoints == 0)
+		{
+			return emptyGlyphSegments;
+		}
+
+		int numSegments = countGlyphSegments(glyphData);
+		uint8* memory = (uint8*)arenaAllocate(arena, getGlyphSegmentsSize(glyphData, numSegments), alignof(Segment));
+		return writeGlyphSegments(glyphData, numSegments, memory);
+	}
+
+	GlyphSegments getGlyphSegments(const Glyph& glyph, const FontInfo& fontInfo, GlyphScratch& scratch, Arena& arena)
+	{
+		GlyphData glyphData = getGlyphData(glyph, fontInfo, scratch);
+		return getGlyphSegments(glyphData, arena);
+	}
+
+	void freeGlyphSegments(GlyphSegments& segments)
+	{
+		// Contour ends share the segments' allocation
+		deallocate(segments.segments);
+		segments = emptyGlyphSegments;
+	}
+
+	int getSegmentSubdivisions(const Segment& segment, float scale, float tolerance)
+	{
+		TTF_ASSERT(tolerance > 0.0f);
+		if (segment.type == SegmentType::Line)
+		{
+			return 1;
+		}
+
+		float ddx = (float)(segment.x0 - 2 * segment.cx + segment.x1);
+		float ddy = (float)(segment.y0 - 2 * segment.cy + segment.y1);
+		float deviation = sqrtf(ddx * ddx + ddy * ddy) * scale;
+		int numLines = (int)ceilf(sqrtf(deviation / (4.0f * tolerance)));
+		return numLines > 1 ? numLines : 1;
+	}
+
+	// One point to start each contour that has segments, then one per line
+	static int countPolylinePoints(const GlyphSegments& segments, float scale, float tolerance)
+	{
+		int numPoints = 0;
+		int segmentBegin = 0;
+		for (int c = 0; c < segments.numContours; c++)
+		{
+			int segmentEnd = segments.contourEnds[c];
+			numPoints += segmentBegin < segmentEnd ? 1 : 0;
+			for (int s = segmentBegin; s < segmentEnd; s++)
+			{
+				numPoints += getSegmentSubdivisions(segments.segments[s], scale, tolerance);
+			}
+			segmentBegin = segmentEnd;
+		}
+		return numPoints;
+	}
+
+	static size_t getPolylineSize(const GlyphSegments& segments, int numPoints)
+	{
+		return sizeof(PolylinePoint) * numPoints + sizeof(int) * segments.numContours;
+	}
+
+	size_t getGlyphPolylineSize(const GlyphSegments& segments, float scale, float tolerance)
+	{
+		return getPolylineSize(segments, countPolylinePoints(segments, scale, tolerance));
+	}
+
+	static const GlyphPolyline emptyGlyphPolyline = {
+		0,
+		nullptr,
+		0,
+		nullptr
+	};
+
+	// Points first, then the contour ends
+	static GlyphPolyline writeGlyphPolyline(const GlyphSegments& segments, float scale, float tolerance, int numPoints, void* memory)
+	{
+		GlyphPolyline result;
+		result.numContours = segments.numContours;
+		result.numPoints = numPoints;
+		result.points = (PolylinePoint*)memory;
+		result.contourEnds = (int*)(result.points + numPoints);
+
+		PolylinePoint* point = result.points;
+		int segmentBegin = 0;
+		for (int c = 0; c < segments.numContours; c++)
+		{
+			int segmentEnd = segments.contourEnds[c];
+			if (segmentBegin < segmentEnd)
+			{
+				const Segment& first = segments.segments[segmentBegin];
+				*point++ = { first.x0 * scale, first.y0 * scale };
+			}
+
+			for (int s = segmentBegin; s < segmentEnd; s++)
+			{
+				const Segment& segment = segments.segments[s];
+				int numLines = getSegmentSubdivisions(segment, scale, tolerance);
+				float step = 1.0f / numLines;
+				for (int i = 1; i < numLines; i++)
+				{
+					float t = i * step;
+					float mt = 1.0f - t;
+					float x = mt * mt * segment.x0 + 2.0f * mt * t * segment.cx + t * t * segment.x1;
+					float y = mt * mt * segment.y0 + 2.0f * mt * t * segment.cy + t * t * segment.y1;
+					*point++ = { x * scale, y * scale };
+				}
+				*point++ = { segment.x1 * scale, segment.y1 * scale };
+			}
+
+			result.contourEnds[c] = (int)(point - result.points);
+			segmentBegin = segmentEnd;
+		}
+		return result;
+	}
+
+	GlyphPolyline flattenGlyphSegments(const GlyphSegments& segments, float scale, float tolerance, void* memory)
+	{
+		if (segments.numSegments == 0)
+		{
+			return emptyGlyphPolyline;
+		}
+		int numPoints = countPolylinePoints(segments, scale, tolerance);
+		return writeGlyphPolyline(segments, scale, tolerance, numPoints, memory);
+	}
+
+	GlyphPolyline flattenGlyphSegments(const GlyphSegments& segments, float scale, float tolerance, Arena& arena)
+	{
+		if (segments.numSegments == 0)
+		{
+			return emptyGlyphPolyline;
+		}
+		int numPoints = countPolylinePoints(segments, scale, tolerance);
+		void* memory = arenaAllocate(arena, getPolylineSize(segments, numPoints), alignof(PolylinePoint));
+		return writeGlyphPolyline(segments, scale, tolerance, numPoints, memory);
+	}
+
+	// A quad in float points that only rises or only falls
+	struct MonotonicCurve
+	{
+		float x0, y0;
+		float cx, cy;
+		float x1, y1;
+	};
+
+	// Writes the quad as one or two curves, split where its y turns around, and returns how many there are.
+	// Curves that don't change y are dropped.
+	static int splitMonotonic(const Segment& segment, float scale, MonotonicCurve* curves)
+	{
+		MonotonicCurve curve = {
+			segment.x0 * scale, segment.y0 * scale,
+			segment.cx * scale, segment.cy * scale,
+			segment.x1 * scale, segment.y1 * scale
+		};
+		if (segment.type == SegmentType::Line)
+		{
+			// A control point halfway along makes the line's coefficients linear in t
+			curve.cx = 0.5f * (curve.x0 + curve.x1);
+			curve.cy = 0.5f * (curve.y0 + curve.y1);
+		}
+
+		int numCurves = 0;
+		float a = curve.y0 - 2.0f * curve.cy + curve.y1;
+		float t = a != 0.0f ? (curve.y0 - curve.cy) / a : 0.0f;
+		if (segment.type == SegmentType::Quad && t > 0.0f && t < 1.0f)
+		{
+			float m0x = curve.x0 + (curve.cx - curve.x0) * t;
+			float m1x = curve.cx + (curve.x1 - curve.cx) * t;
+			float m0y = curve.y0 + (curve.cy - curve.y0) * t;
+			float m1y = curve.cy + (curve.y1 - curve.cy) * t;
+			float midX = m0x + (m1x - m0x) * t;
+			float midY = m0y + (m1y - m0y) * t;
+
+			// The controls next to the turning point are level with it, which rounding alone doesn't guarantee
+			curves[numCurves++] = { curve.x0, curve.y0, m0x, midY, midX, midY };
+			curve = { midX, midY, m1x, midY, curve.x1, curve.y1 };
+			if (curves[0].y0 == midY)
+			{
+				numCurves--;
+			}
+		}
+		if (curve.y0 != curve.y1)
+		{
+			curves[numCurves++] = curve;
+		}
+		return numCurves;
+	}
+
+	PreparedOutline prepareGlyphOutline(const GlyphSegments& segments, float scale, Arena& arena)
+	{
+		PreparedOutline outline = {};
+		outline.scale = scale;
+
+		// Split into scratch at the top of the arena, then sort and move into the arrays below it
+		int capacity = segments.numSegments * 2;
+		float** arrays[] = { &outline.minY, &outline.maxY, &outline.ax, &outline.bx, &outline.cx, &outline.ay, &outline.by, &outline.cy };
+		for (float** array : arrays)
+		{
+			*array = (float*)arenaAllocate(arena, sizeof(float) * capacity, 16);
+		}
+		outline.winding = (int8*)arenaAllocate(arena, sizeof(int8) * capacity, 1);
+
+		ArenaMarker marker = getArenaMarker(arena);
+		MonotonicCurve* curves = (MonotonicCurve*)arenaAllocate(arena, sizeof(MonotonicCurve) * capacity, alignof(MonotonicCurve));
+		int numCurves = 0;
+		for (int s = 0; s < segments.numSegments; s++)
+		{
+			numCurves += splitMonotonic(segments.segments[s], scale, curves + numCurves);
+		}
+		std::sort(curves, curves + numCurves, [](const MonotonicCurve& a, const MonotonicCurve& b)
+			{
+				return std::min(a.y0, a.y1) < std::min(b.y0, b.y1);
+			});
+
+		for (int i = 0; i < numCurves; i++)
+		{
+			const MonotonicCurve& curve = curves[i];
+			outline.minY[i] = std::min(curve.y0, curve.y1);
+			outline.maxY[i] = std::max(curve.y0, curve.y1);
+			outline.ax[i] = curve.x0 - 2.0f * curve.cx + curve.x1;
+			outline.bx[i] = 2.0f * (curve.cx - curve.x0);
+			outline.cx[i] = curve.x0;
+			outline.ay[i] = curve.y0 - 2.0f * curve.cy + curve.y1;
+			outline.by[i] = 2.0f * (curve.cy - curve.y0);
+			outline.cy[i] = curve.y0;
+			outline.winding[i] = curve.y1 > curve.y0 ? -1 : 1;
+		}
+		outline.numCurves = numCurves;
+
+		rewindArena(arena, marker);
+		return outline;
+	}
+
+	static bool beginSimpleGlyph(SegmentIterator& iterator, const Glyph& glyph, const ComponentMatrix& matrix, int16 offsetX, int16 offsetY)
+	{
+		if (!getSimpleGlyphLayout(glyph, *iterator.fontInfo, iterator.layout))
+		{
+			iterator.layout.numContours = 0;
+			return false;
+		}
+
+		iterator.matrix = matrix;
+		iterator.transformed = matrix.a != 1.0f || matrix.b != 0.0f || matrix.c != 0.0f || matrix.d != 1.0f;
+		iterator.offsetX = offsetX;
+		iterator.offsetY = offsetY;
+		iterator.point = 0;
+		iterator.contour = 0;
+		iterator.flagRepeat = 0;
+		iterator.x = 0;
+		iterator.y = 0;
+		iterator.inContour = false;
+		return true;
+	}
+
+	// Reads the next point of the simple glyph and returns whether it is on the curve
+	static bool readPoint(SegmentIterator& iterator, int16& x, int16& y)
+	{
+		if (iterator.flagRepeat > 0)
+		{
+			iterator.flagRepeat--;
+		}
+		else
+		{
+			iterator.flag = *iterator.layout.flags++;
+			if (iterator.flag & REPEAT)
+			{
+				iterator.flagRepeat = *iterator.layout.flags++;
+			}
+		}
+
+		iterator.x += readGlyphCoordinateDelta(iterator.flag, iterator.layout.xCoords, X_IS_BYTE, X_DELTA);
+		iterator.y += readGlyphCoordinateDelta(iterator.flag, iterator.layout.yCoords, Y_IS_BYTE, Y_DELTA);
+		iterator.point++;
+		x = iterator.x;
+		y = iterator.y;
+		return (iterator.flag & ON_CURVE) != 0;
+	}
+
+	// Reads up to the contour's first on curve point, real or implied, the same one walkContour starts at.
+	// Returns false for contours without any segments.
+	static bool beginContour(SegmentIterator& iterator)
+	{
+		iterator.contourEnd = loadUint16(iterator.layout.contourEnds + iterator.contour * 2);
+		iterator.contour++;
+		if (iterator.contourEnd < iterator.point)
+		{
+			return false;
+		}
+
+		int16 x, y;
+		iterator.hasControl = false;
+		if (readPoint(iterator, x, y))
+		{
+			iterator.startOffCurve = false;
+		}
+		else
+		{
+			if (iterator.point > iterator.contourEnd)
+			{
+				return false;
+			}
+
+			iterator.startOffCurve = true;
+			iterator.startControlX = x;
+			iterator.startControlY = y;
+			int16 nextX, nextY;
+			if (readPoint(iterator, nextX, nextY))
+			{
+				x = nextX;
+				y = nextY;
+			}
+			else
+			{
+				iterator.hasControl = true;
+				iterator.controlX = nextX;
+				iterator.controlY = nextY;
+				x = (x + nextX) / 2;
+				y = (y + nextY) / 2;
+			}
+		}
+
+		iterator.startX = iterator.currentX = x;
+		iterator.startY = iterator.currentY = y;
+		iterator.inContour = true;
+		return true;
+	}
+
+	static void placePoint(const SegmentIterator& iterator, int16 x, int16 y, int16& outX, int16& outY)
+	{
+		if (iterator.transformed)
+		{
+			transformPoint(iterator.matrix, x, y);
+		}
+		outX = x + iterator.offsetX;
+		outY = y + iterator.offsetY;
+	}
+
+	// Writes the segment from the current point to (x, y) and makes that the current point
+	static void emitSegment(SegmentIterator& iterator, SegmentType type, int16 cx, int16 cy, int16 x, int16 y, Segment& segment)
+	{
+		segment.type = type;
+		placePoint(iterator, iterator.currentX, iterator.currentY, segment.x0, segment.y0);
+		placePoint(iterator, cx, cy, segment.cx, segment.cy);
+		placePoint(iterator, x, y, segment.x1, segment.y1);
+		iterator.currentX = x;
+		iterator.currentY = y;
+	}
+
+	// Moves on to the next simple glyph of the composites on the stack. Returns false when they are all done.
+	static bool nextComponent(SegmentIterator& iterator)
+	{
+		const FontInfo& fontInfo = *iterator.fontInfo;
+		while (iterator.depth > 0)
+		{
+			ComponentCursor& parent = iterator.components[iterator.depth - 1];
+			if (parent.next == nullptr)
+			{
+				iterator.depth--;
+				continue;
+			}
+
+			Buffer buffer = getBuffer((uint8*)parent.next, fontInfo);
+			GlyphComponent component;
+			if (!readGlyphComponent(buffer, component) || !(component.flags & ARGS_ARE_XY_VALUES) || component.glyphId >= fontInfo.numGlyphs)
+			{
+				iterator.failed = true;
+				return false;
+			}
+			parent.next = (component.flags & MORE_COMPONENTS) ? cursorPtr(buffer) : nullptr;
+
+			ComponentMatrix combined = combineComponentMatrices(parent.matrix, component.matrix);
+			int16 offsetX, offsetY;
+			getComponentOffset(component, parent.matrix, combined, offsetX, offsetY);
+			offsetX += parent.offsetX;
+			offsetY += parent.offsetY;
+
+			Glyph glyph = getGlyphById(component.glyphId, fontInfo);
+			if (glyph.numberOfContours > 0)
+			{
+				if (!beginSimpleGlyph(iterator, glyph, combined, offsetX, offsetY))
+				{
+					iterator.failed = true;
+					return false;
+				}
+				return true;
+			}
+			if (glyph.numberOfContours < 0)
+			{
+				if (iterator.depth >= MAX_COMPONENT_DEPTH || glyph.compositeGlyphTable == nullptr)
+				{
+					iterator.failed = true;
+					return false;
+				}
+				iterator.components[iterator.depth++] = { glyph.compositeGlyphTable, combined, offsetX, offsetY };
+			}
+		}
+		return false;
+	}
+
+	void beginGlyphSegments(SegmentIterator& iterator, const Glyph& glyph, const FontInfo& fontInfo)
+	{
+		iterator.fontInfo = &fontInfo;
+		iterator.failed = false;
+		iterator.layout.numContours = 0;
+		iterator.inContour = false;
+		iterator.contour = 0;
+		iterator.depth = 0;
+
+		ComponentMatrix identity = { 1.0f, 0.0f, 0.0f, 1.0f };
+		if (glyph.numberOfContours > 0)
+		{
+			iterator.failed = !beginSimpleGlyph(iterator, glyph, identity, 0, 0);
+		}
+		else if (glyph.numberOfContours < 0)
+		{
+			if (glyph.compositeGlyphTable == nullptr)
+			{
+				iterator.failed = true;
+				return;
+			}
+			iterator.components[iterator.depth++] = { glyph.compositeGlyphTable, identity, 0, 0 };
+		}
+	}
+
+	bool nextGlyphSegment(SegmentIterator& iterator, Segment& segment)
+	{
+		for (;;)
+		{
+			if (iterator.inContour)
+			{
+				if (iterator.point <= iterator.contourEnd)
+				{
+					int16 x, y;
+					if (readPoint(iterator, x, y))
+					{
+						if (iterator.hasControl)
+						{
+							emitSegment(iterator, SegmentType::Quad, iterator.controlX, iterator.controlY, x, y, segment);
+							iterator.hasControl = false;
+						}
+						else
+						{
+							emitSegment(iterator, SegmentType::Line, iterator.currentX, iterator.currentY, x, y, segment);
+						}
+						return true;
+					}
+
+					if (!iterator.hasControl)
+					{
+						iterator.hasControl = true;
+						iterator.controlX = x;
+						iterator.controlY = y;
+						continue;
+					}
+
+					// Two off curve points in a row, the implied on curve point is halfway between them
+					int16 midX = (iterator.controlX + x) / 2;
+					int16 midY = (iterator.controlY + y) / 2;
+					emitSegment(iterator, SegmentType::Quad, iterator.controlX, iterator.controlY, midX, midY, segment);
+					iterator.controlX = x;
+					iterator.controlY = y;
+					return true;
+				}
+
+				// Close the contour back to its start, through the off curve point it started with if there was one
+				if (iterator.startOffCurve)
+				{
+					if (iterator.hasControl)
+					{
+						int16 midX = (iterator.controlX + iterator.startControlX) / 2;
+						int16 midY = (iterator.controlY + iterator.startControlY) / 2;
+						emitSegment(iterator, SegmentType::Quad, iterator.controlX, iterator.controlY, midX, midY, segment);
+						iterator.hasControl = false;
+						return true;
+					}
+					emitSegment(iterator, SegmentType::Quad, iterator.startControlX, iterator.startControlY, iterator.startX, iterator.startY, segment);
+				}
+				else if (iterator.hasControl)
+				{
+					emitSegment(iterator, SegmentType::Quad, iterator.controlX, iterator.controlY, iterator.startX, iterator.startY, segment);
+				}
+				else
+				{
+					emitSegment(iterator, SegmentType::Line, iterator.currentX, iterator.currentY, iterator.startX, iterator.startY, segment);
+				}
+				iterator.inContour = false;
+				return true;
+			}
+
+			if (iterator.failed)
+			{
+				return false;
+			}
+
+			if (iterator.contour < iterator.layout.numContours)
+			{
+				beginContour(iterator);
+				continue;
+			}
+
+			if (!nextComponent(iterator))
+			{
+				return false;
+			}
+		}
+	}
+}
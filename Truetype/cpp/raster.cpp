@@ -0,0 +1,479 @@
+#include "raster.h"
+#include "glyph.h"
+#include "memory.h"
+#include "outline.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace Truetype
+{
+	struct CurveCrossing
+	{
+		float x;
+		int winding;
+	};
+
+	// Where the horizontal line at y crosses curve i, which has to span it. Rising curves cross where the slope is
+	// positive and falling ones where it's negative, which picks the root. It's solved as 2c / (-b -+ sqrt(b^2 - 4ac))
+	// so lines, where a is 0, and nearly flat quads don't lose precision.
+	static float getCrossingX(const PreparedOutline& outline, int i, float y)
+	{
+		float a = outline.ay[i];
+		float b = outline.by[i];
+		float c = outline.cy[i] - y;
+		float squareRootOperand = b * b - 4.0f * a * c;
+		float squareRoot = sqrtf(squareRootOperand > 0.0f ? squareRootOperand : 0.0f);
+		float denominator = outline.winding[i] < 0 ? -b - squareRoot : -b + squareRoot;
+		float t = denominator != 0.0f ? 2.0f * c / denominator : 0.0f;
+		t = std::min(std::max(t, 0.0f), 1.0f);
+		return (outline.ax[i] * t + outline.bx[i]) * t + outline.cx[i];
+	}
+
+	// Map coordinates from canvas range to glyph range
+	static int16 getSampleX(int x, const Glyph& glyph, int width)
+	{
+		return (int16)(((float)x / (float)width) * (float)(glyph.xMax - glyph.xMin) + (float)glyph.xMin);
+	}
+
+	static int16 getSampleY(int y, const Glyph& glyph, int height)
+	{
+		return (int16)(((float)y / (float)height) * (float)(glyph.yMax - glyph.yMin) + (float)glyph.yMin);
+	}
+
+	void rasterizeGlyphWinding(const PreparedOutline& outline, const Glyph& glyph, int width, int height, uint8* pixels)
+	{
+		for (int y = 0; y < height; y++)
+		{
+			float sampleY = getSampleY(y, glyph, height) * outline.scale;
+			for (int x = 0; x < width; x++)
+			{
+				float sampleX = getSampleX(x, glyph, width) * outline.scale;
+
+				// If the winding number is 0, pixel is off, otherwise pixel is on
+				int windingNumber = 0;
+				for (int i = 0; i < outline.numCurves; i++)
+				{
+					if (outline.minY[i] <= sampleY && sampleY < outline.maxY[i] && getCrossingX(outline, i, sampleY) >= sampleX)
+					{
+						windingNumber += outline.winding[i];
+					}
+				}
+				pixels[(size_t)y * width + x] = windingNumber != 0 ? 255 : 0;
+			}
+		}
+	}
+
+	void rasterizeGlyphWinding(const GlyphSegments& segments, const Glyph& glyph, int width, int height, uint8* pixels, Arena& arena)
+	{
+		ArenaMarker marker = getArenaMarker(arena);
+		PreparedOutline outline = prepareGlyphOutline(segments, 1.0f, arena);
+		rasterizeGlyphWinding(outline, glyph, width, height, pixels);
+		rewindArena(arena, marker);
+	}
+
+	void rasterizeGlyphScanline(const PreparedOutline& outline, const Glyph& glyph, int width, int height, uint8* pixels, Arena& arena)
+	{
+		if (width <= 0 || height <= 0)
+		{
+			return;
+		}
+
+		ArenaMarker marker = getArenaMarker(arena);
+		int numCurves = outline.numCurves;
+		int* activeCurves = (int*)arenaAllocate(arena, sizeof(int) * numCurves, alignof(int));
+		CurveCrossing* crossings = (CurveCrossing*)arenaAllocate(arena, sizeof(CurveCrossing) * numCurves, alignof(CurveCrossing));
+		float* sampleXs = (float*)arenaAllocate(arena, sizeof(float) * width, alignof(float));
+
+		// Columns map to the same x on every row
+		for (int x = 0; x < width; x++)
+		{
+			sampleXs[x] = getSampleX(x, glyph, width) * outline.scale;
+		}
+
+		int nextCurve = 0;
+		int numActive = 0;
+		int16 previousSampleY = 0;
+		for (int y = 0; y < height; y++)
+		{
+			uint8* row = pixels + (size_t)y * width;
+			int16 fontUnitY = getSampleY(y, glyph, height);
+			if (y > 0 && fontUnitY == previousSampleY)
+			{
+				// Rows that sample the same font unit line come out the same
+				memcpy(row, row - width, width);
+				continue;
+			}
+			previousSampleY = fontUnitY;
+			float sampleY = fontUnitY * outline.scale;
+
+			// The outline is sorted by minY, so curves start crossing rows in order and stop at their highest point
+			while (nextCurve < numCurves && outline.minY[nextCurve] <= sampleY)
+			{
+				activeCurves[numActive++] = nextCurve++;
+			}
+
+			int numCrossings = 0;
+			int totalWinding = 0;
+			for (int i = 0; i < numActive;)
+			{
+				int curve = activeCurves[i];
+				if (outline.maxY[curve] <= sampleY)
+				{
+					activeCurves[i] = activeCurves[--numActive];
+					continue;
+				}
+
+				crossings[numCrossings++] = { getCrossingX(outline, curve, sampleY), outline.winding[curve] };
+				totalWinding += outline.winding[curve];
+				i++;
+			}
+
+			// Few curves cross a row, so insertion sort beats anything fancier
+			for (int i = 1; i < numCrossings; i++)
+			{
+				CurveCrossing crossing = crossings[i];
+				int j = i;
+				for (; j > 0 && crossings[j - 1].x > crossing.x; j--)
+				{
+					crossings[j] = crossings[j - 1];
+				}
+				crossings[j] = crossing;
+			}
+
+			// A pixel's winding number sums the crossings at or right of it, so it starts at the row's total and
+			// drops by each crossing the sweep passes
+			int windingNumber = totalWinding;
+			int column = 0;
+			for (int i = 0; i < numCrossings && column < width; i++)
+			{
+				int spanStart = column;
+				while (column < width && sampleXs[column] <= crossings[i].x)
+				{
+					column++;
+				}
+				memset(row + spanStart, windingNumber != 0 ? 255 : 0, column - spanStart);
+				windingNumber -= crossings[i].winding;
+			}
+			memset(row + column, windingNumber != 0 ? 255 : 0, width - column);
+		}
+
+		rewindArena(arena, marker);
+	}
+
+	void rasterizeGlyphScanline(const GlyphSegments& segments, const Glyph& glyph, int width, int height, uint8* pixels, Arena& arena)
+	{
+		ArenaMarker marker = getArenaMarker(arena);
+		PreparedOutline outline = prepareGlyphOutline(segments, 1.0f, arena);
+		rasterizeGlyphScanline(outline, glyph, width, height, pixels, arena);
+		rewindArena(arena, marker);
+	}
+
+	// Adds the signed area of the line to the cells it passes through, a row of stride cells for every pixel row.
+	// Within a row the line adds dy to the cells right of it, split between the cells it crosses by how much of
+	// each one lies right of it. Rows are cut to the bitmap. The line has to be within [0, width] in x, apart from
+	// rounding, which the clamp absorbs.
+	static void accumulateLineInside(float* cells, int stride, int width, int height, PolylinePoint p0, PolylinePoint p1)
+	{
+		if (fabsf(p0.y - p1.y) <= 1e-7f)
+		{
+			return;
+		}
+
+		float direction = 1.0f;
+		if (p0.y > p1.y)
+		{
+			std::swap(p0, p1);
+			direction = -1.0f;
+		}
+		p0.x = std::min(std::max(p0.x, 0.0f), (float)width);
+		p1.x = std::min(std::max(p1.x, 0.0f), (float)width);
+
+		float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+		float x = p0.x;
+		if (p0.y < 0.0f)
+		{
+			x -= p0.y * dxdy;
+		}
+
+		int yStart = p0.y > 0.0f ? (int)p0.y : 0;
+		int yEnd = std::min(height, (int)ceilf(p1.y));
+		for (int y = yStart; y < yEnd; y++)
+		{
+			float* row = cells + (size_t)y * stride;
+			float dy = std::min((float)(y + 1), p1.y) - std::max((float)y, p0.y);
+			float xNext = x + dxdy * dy;
+			float d = dy * direction;
+
+			// x is clamped to the bitmap, so truncating floors it
+			float x0 = std::min(x, xNext);
+			float x1 = std::max(x, xNext);
+			int x0i = (int)x0;
+			float x0Floor = (float)x0i;
+			int x1i = (int)x1;
+			x1i += (float)x1i < x1 ? 1 : 0;
+			float x1Ceil = (float)x1i;
+			if (x1i <= x0i + 1)
+			{
+				// Inside one cell, the part right of the line's middle goes to the next one
+				float xm = 0.5f * (x + xNext) - x0Floor;
+				row[x0i] += d - d * xm;
+				row[x0i + 1] += d * xm;
+			}
+			else
+			{
+				// Across several cells, the covered area ramps up as a triangle, then a constant slope, then a
+				// triangle again
+				float s = 1.0f / (x1 - x0);
+				float x0f = x0 - x0Floor;
+				float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+				float x1f = x1 - x1Ceil + 1.0f;
+				float am = 0.5f * s * x1f * x1f;
+				row[x0i] += d * a0;
+				if (x1i == x0i + 2)
+				{
+					row[x0i + 1] += d * (1.0f - a0 - am);
+				}
+				else
+				{
+					float a1 = s * (1.5f - x0f);
+					row[x0i + 1] += d * (a1 - a0);
+					for (int xi = x0i + 2; xi < x1i - 1; xi++)
+					{
+						row[xi] += d * s;
+					}
+					float a2 = a1 + (float)(x1i - x0i - 3) * s;
+					row[x1i - 1] += d * (1.0f - a2 - am);
+				}
+				row[x1i] += d * am;
+			}
+			x = xNext;
+		}
+	}
+
+	// Clips the line to the bitmap's columns by splitting it where it crosses x = 0 and x = width. A part left of
+	// the bitmap covers every cell right of it, which is the same area as a vertical line on the left edge. A part
+	// right of it covers nothing, and on the right edge it only reaches the cells past the last pixel.
+	static void accumulateLine(float* cells, int stride, int width, int height, PolylinePoint p0, PolylinePoint p1)
+	{
+		float edges[2] = { 0.0f, (float)width };
+		float splits[2];
+		int numSplits = 0;
+		for (float edge : edges)
+		{
+			if ((p0.x < edge) != (p1.x < edge))
+			{
+				splits[numSplits++] = (edge - p0.x) / (p1.x - p0.x);
+			}
+		}
+		if (numSplits == 2 && splits[0] > splits[1])
+		{
+			std::swap(splits[0], splits[1]);
+		}
+
+		PolylinePoint start = p0;
+		for (int i = 0; i < numSplits; i++)
+		{
+			PolylinePoint end = { p0.x + (p1.x - p0.x) * splits[i], p0.y + (p1.y - p0.y) * splits[i] };
+			accumulateLineInside(cells, stride, width, height, start, end);
+			start = end;
+		}
+		accumulateLineInside(cells, stride, width, height, start, p1);
+	}
+
+	// Sets the bits of the pixels at least half covered, most significant bit first, and clears the rest of the
+	// last byte
+	static void packMonoRow(const uint8* coverage, int width, uint8* row)
+	{
+		for (int x = 0; x < width; x += 8)
+		{
+			uint8 bits = 0;
+			int end = std::min(width - x, 8);
+			for (int bit = 0; bit < end; bit++)
+			{
+				bits |= coverage[x + bit] >= 128 ? (uint8)(0x80 >> bit) : 0;
+			}
+			row[x / 8] = bits;
+		}
+	}
+
+	void rasterizeGlyphCoverage(const GlyphPolyline& polyline, float offsetX, float offsetY, const GlyphBitmap& bitmap, Arena& arena)
+	{
+		int width = bitmap.width;
+		int height = bitmap.height;
+		if (width <= 0 || height <= 0)
+		{
+			return;
+		}
+		TTF_ASSERT(abs(bitmap.stride) >= getBitmapRowBytes(width, bitmap.format));
+
+		// Lines at the right edge write up to two cells past the last pixel
+		ArenaMarker marker = getArenaMarker(arena);
+		int cellStride = width + 2;
+		float* cells = (float*)arenaAllocate(arena, sizeof(float) * cellStride * height, 16);
+		memset(cells, 0, sizeof(float) * cellStride * height);
+
+		int begin = 0;
+		for (int c = 0; c < polyline.numContours; c++)
+		{
+			int end = polyline.contourEnds[c];
+			for (int p = begin; p + 1 < end; p++)
+			{
+				PolylinePoint p0 = { polyline.points[p].x + offsetX, polyline.points[p].y + offsetY };
+				PolylinePoint p1 = { polyline.points[p + 1].x + offsetX, polyline.points[p + 1].y + offsetY };
+				accumulateLine(cells, cellStride, width, height, p0, p1);
+			}
+			begin = end;
+		}
+
+		// 1-bit rows are accumulated into a scratch row of alpha first
+		uint8* coverageRow = nullptr;
+		if (bitmap.format == PixelFormat::Mono1)
+		{
+			coverageRow = (uint8*)arenaAllocate(arena, width, 1);
+		}
+
+		for (int y = 0; y < height; y++)
+		{
+			uint8* row = bitmap.pixels + (ptrdiff_t)y * bitmap.stride;
+			if (bitmap.format == PixelFormat::Alpha8)
+			{
+				accumulateCoverage(cells + (size_t)y * cellStride, row, width);
+			}
+			else
+			{
+				accumulateCoverage(cells + (size_t)y * cellStride, coverageRow, width);
+				packMonoRow(coverageRow, width, row);
+			}
+		}
+
+		rewindArena(arena, marker);
+	}
+
+	void rasterizeGlyphCoverage(const GlyphPolyline& polyline, float offsetX, float offsetY, int width, int height, uint8* pixels, Arena& arena)
+	{
+		GlyphBitmap bitmap = { 0, 0, width, height, pixels, width, PixelFormat::Alpha8 };
+		rasterizeGlyphCoverage(polyline, offsetX, offsetY, bitmap, arena);
+	}
+
+	int getBitmapRowBytes(int width, PixelFormat format)
+	{
+		return format == PixelFormat::Mono1 ? (width + 7) / 8 : width;
+	}
+
+	// Lines stay within this many pixels of the curves they replace
+	static const float RASTER_TOLERANCE = 0.25f;
+
+	GlyphPlacement createGlyphPlacement(float pixelsPerEm, float subpixelX, float subpixelY)
+	{
+		return createGlyphPlacement(pixelsPerEm, { 1.0f, 0.0f, 0.0f, 1.0f }, subpixelX, subpixelY);
+	}
+
+	GlyphPlacement createGlyphPlacement(float pixelsPerEm, const ComponentMatrix& matrix, float subpixelX, float subpixelY)
+	{
+		GlyphPlacement placement;
+		placement.pixelsPerEm = pixelsPerEm;
+		placement.subpixelX = subpixelX;
+		placement.subpixelY = subpixelY;
+		placement.matrix = matrix;
+		return placement;
+	}
+
+	// The most the matrix stretches any direction, its largest singular value
+	static float getMaxStretch(const ComponentMatrix& m)
+	{
+		float sumOfSquares = m.a * m.a + m.b * m.b + m.c * m.c + m.d * m.d;
+		float determinant = m.a * m.d - m.b * m.c;
+		float discriminant = sumOfSquares * sumOfSquares - 4.0f * determinant * determinant;
+		return sqrtf(0.5f * (sumOfSquares + sqrtf(discriminant > 0.0f ? discriminant : 0.0f)));
+	}
+
+	static bool isIdentity(const ComponentMatrix& m)
+	{
+		return m.a == 1.0f && m.b == 0.0f && m.c == 0.0f && m.d == 1.0f;
+	}
+
+	GlyphBitmap getGlyphBitmapBox(const Glyph& glyph, const FontInfo& fontInfo, const GlyphPlacement& placement)
+	{
+		GlyphBitmap bitmap = { 0, 0, 0, 0, nullptr, 0, PixelFormat::Alpha8 };
+		if (glyph.numberOfContours == 0 || glyph.xMax <= glyph.xMin || glyph.yMax <= glyph.yMin)
+		{
+			return bitmap;
+		}
+
+		// A linear map of the box holds the mapped outline, so its corners bound the bitmap
+		float scale = placement.pixelsPerEm / fontInfo.unitsPerEm;
+		const ComponentMatrix& m = placement.matrix;
+		float cornersX[4] = { glyph.xMin * scale, glyph.xMax * scale, glyph.xMin * scale, glyph.xMax * scale };
+		float cornersY[4] = { glyph.yMin * scale, glyph.yMin * scale, glyph.yMax * scale, glyph.yMax * scale };
+		float minX = FLT_MAX;
+		float minY = FLT_MAX;
+		float maxX = -FLT_MAX;
+		float maxY = -FLT_MAX;
+		for (int i = 0; i < 4; i++)
+		{
+			float x = m.a * cornersX[i] + m.c * cornersY[i] + placement.subpixelX;
+			float y = m.b * cornersX[i] + m.d * cornersY[i] + placement.subpixelY;
+			minX = std::min(minX, x);
+			minY = std::min(minY, y);
+			maxX = std::max(maxX, x);
+			maxY = std::max(maxY, y);
+		}
+
+		bitmap.x = (int)floorf(minX);
+		bitmap.y = (int)floorf(minY);
+		bitmap.width = (int)ceilf(maxX) - bitmap.x;
+		bitmap.height = (int)ceilf(maxY) - bitmap.y;
+		bitmap.stride = bitmap.width;
+		return bitmap;
+	}
+
+	void rasterizeGlyph(const Glyph& glyph, const FontInfo& fontInfo, const GlyphPlacement& placement, const GlyphBitmap& bitmap, Arena& arena)
+	{
+		if (bitmap.width <= 0 || bitmap.height <= 0)
+		{
+			return;
+		}
+
+		ArenaMarker marker = getArenaMarker(arena);
+		GlyphData glyphData = getGlyphData(glyph, fontInfo, arena);
+		GlyphSegments segments = getGlyphSegments(glyphData, arena);
+
+		// Flattened at the most the matrix stretches, so the tolerance holds in every direction once it is applied
+		float stretch = isIdentity(placement.matrix) ? 1.0f : getMaxStretch(placement.matrix);
+		float scale = placement.pixelsPerEm / fontInfo.unitsPerEm;
+		GlyphPolyline polyline = flattenGlyphSegments(segments, scale * stretch, RASTER_TOLERANCE, arena);
+		if (!isIdentity(placement.matrix))
+		{
+			const ComponentMatrix& m = placement.matrix;
+			float inverseStretch = stretch > 0.0f ? 1.0f / stretch : 0.0f;
+			for (int p = 0; p < polyline.numPoints; p++)
+			{
+				float x = polyline.points[p].x * inverseStretch;
+				float y = polyline.points[p].y * inverseStretch;
+				polyline.points[p].x = m.a * x + m.c * y;
+				polyline.points[p].y = m.b * x + m.d * y;
+			}
+		}
+
+		rasterizeGlyphCoverage(polyline, placement.subpixelX - bitmap.x, placement.subpixelY - bitmap.y, bitmap, arena);
+		rewindArena(arena, marker);
+	}
+
+	GlyphBitmap rasterizeGlyph(const Glyph& glyph, const FontInfo& fontInfo, const GlyphPlacement& placement, Arena& arena, PixelFormat format)
+	{
+		GlyphBitmap bitmap = getGlyphBitmapBox(glyph, fontInfo, placement);
+		bitmap.format = format;
+		bitmap.stride = getBitmapRowBytes(bitmap.width, format);
+		if (bitmap.width > 0 && bitmap.height > 0)
+		{
+			bitmap.pixels = (uint8*)arenaAllocate(arena, (size_t)bitmap.stride * bitmap.height, 1);
+			rasterizeGlyph(glyph, fontInfo, placement, bitmap, arena);
+		}
+		return bitmap;
+	}
+}
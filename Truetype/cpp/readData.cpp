@@ -6,10 +6,10 @@ namespace Truetype
 	bool tagEquals(uint8* p, char c0, char c1, char c2, char c3) { return ((p)[0] == (c0) && (p)[1] == (c1) && (p)[2] == (c2) && (p)[3] == (c3)); }
 	bool tagEquals(uint8* p, const char* str) { return tagEquals(p, str[0], str[1], str[2], str[3]); }
 
-	uint16 toUShort(uint8* pointer) { return pointer[0] * 256 + pointer[1]; }
-	int16 toShort(uint8* pointer) { return pointer[0] * 256 + pointer[1]; }
-	uint32 toULong(uint8* pointer) { return (pointer[0] << 24) | (pointer[1] << 16) | (pointer[2] << 8) | pointer[3]; }
-	int32 toLong(uint8* pointer) { return (pointer[0] << 24) | (pointer[1] << 16) | (pointer[2] << 8) | pointer[3]; }
+	uint16 toUShort(uint8* pointer) { return loadUint16(pointer); }
+	int16 toShort(uint8* pointer) { return loadInt16(pointer); }
+	uint32 toULong(uint8* pointer) { return loadUint32(pointer); }
+	int32 toLong(uint8* pointer) { return loadInt32(pointer); }
 
 	uint8 getUint8(Buffer& buffer)
 	{
@@ -38,8 +38,17 @@ namespace Truetype
 
 	uint32 get(Buffer& buffer, int numBytes)
 	{
-		uint32 value = 0;
 		TTF_ASSERT(numBytes >= 1 && numBytes <= 4);
+		if (canRead(buffer, 4))
+		{
+			// Load 4 bytes at once and shift off the ones we did not ask for
+			uint32 value = loadUint32(cursorPtr(buffer)) >> ((4 - numBytes) * 8);
+			buffer.cursor += numBytes;
+			return value;
+		}
+
+		// Near the end of the buffer, bytes past the end read as 0
+		uint32 value = 0;
 		for (int i = 0; i < numBytes; i++)
 			value = (value << 8) | getUint8(buffer);
 		return value;
@@ -47,32 +56,63 @@ namespace Truetype
 
 	uint16 getUint16(Buffer& buffer)
 	{
+		if (canRead(buffer, 2))
+		{
+			uint16 value = loadUint16(cursorPtr(buffer));
+			buffer.cursor += 2;
+			return value;
+		}
 		return get(buffer, 2);
 	}
 
 	uint32 getUint32(Buffer& buffer)
 	{
+		if (canRead(buffer, 4))
+		{
+			uint32 value = loadUint32(cursorPtr(buffer));
+			buffer.cursor += 4;
+			return value;
+		}
 		return get(buffer, 4);
 	}
 
 	uint64 getUint64(Buffer& buffer)
 	{
-		return (get(buffer, 4) << 32) | get(buffer, 4);
+		uint64 high = getUint32(buffer);
+		uint64 low = getUint32(buffer);
+		return (high << 32) | low;
 	}
 
 	int16 getInt16(Buffer& buffer)
 	{
-		// Read the data as 2's complement if necessary
-		// See here: https://stackoverflow.com/a/60881515
-		uint16 val = getUint16(buffer);
-		if (val & 0x8000) return -(int)(~val) - 1;
-		return val;
+		return (int16)getUint16(buffer);
 	}
 
 
 	int32 getInt32(Buffer& buffer)
 	{
-		return get(buffer, 4);
+		return (int32)getUint32(buffer);
+	}
+
+	void getUint16Array(Buffer& buffer, uint16* values, int count)
+	{
+		int available = (buffer.size - buffer.cursor) / 2;
+		int numToRead = count < available ? count : available;
+		const uint8* src = cursorPtr(buffer);
+		for (int i = 0; i < numToRead; i++)
+		{
+			values[i] = loadUint16(src + i * 2);
+		}
+		for (int i = numToRead; i < count; i++)
+		{
+			values[i] = 0;
+		}
+		skip(buffer, numToRead * 2);
+	}
+
+	void getInt16Array(Buffer& buffer, int16* values, int count)
+	{
+		getUint16Array(buffer, (uint16*)values, count);
 	}
 
 	Tag getTag(Buffer& buffer)
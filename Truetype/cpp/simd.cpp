@@ -0,0 +1,338 @@
+#include "simd.h"
+
+#include <math.h>
+#include <string.h>
+
+#if TTF_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+namespace Truetype
+{
+	static bool g_simdEnabled = true;
+
+	void setSimdEnabled(bool enabled)
+	{
+		g_simdEnabled = enabled;
+	}
+
+#if TTF_X86
+	struct CpuFeatures
+	{
+		bool ssse3;
+		bool avx2;
+	};
+
+	static CpuFeatures detectCpuFeatures()
+	{
+		CpuFeatures features = { false, false };
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		features.ssse3 = (info[2] & (1 << 9)) != 0;
+		bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+		if (maxLeaf >= 7 && osSavesYmm)
+		{
+			__cpuidex(info, 7, 0);
+			features.avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		features.ssse3 = __builtin_cpu_supports("ssse3");
+		features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+		return features;
+	}
+
+	static const CpuFeatures& getCpuFeatures()
+	{
+		static CpuFeatures features = detectCpuFeatures();
+		return features;
+	}
+
+	bool cpuHasSsse3() { return g_simdEnabled && getCpuFeatures().ssse3; }
+	bool cpuHasAvx2() { return g_simdEnabled && getCpuFeatures().avx2; }
+
+	TTF_TARGET_SSSE3
+	static size_t decodeBigEndianUint32sSsse3(const uint8* src, uint32* dst, size_t count)
+	{
+		const __m128i swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i values = _mm_loadu_si128((const __m128i*)(src + i * 4));
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(values, swap));
+		}
+		return i;
+	}
+
+	TTF_TARGET_AVX2
+	static size_t decodeBigEndianUint32sAvx2(const uint8* src, uint32* dst, size_t count)
+	{
+		const __m256i swap = _mm256_setr_epi8(
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i values = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+			_mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(values, swap));
+		}
+		return i;
+	}
+
+	TTF_TARGET_SSSE3
+	static size_t decodeBigEndianUint16sToUint32sSsse3(const uint8* src, uint32* dst, size_t count, uint32 scale)
+	{
+		// Moves each big endian uint16 into the low half of a uint32 lane, zeroing the high half (-1 selects zero)
+		const __m128i swapLow = _mm_setr_epi8(1, 0, -1, -1, 3, 2, -1, -1, 5, 4, -1, -1, 7, 6, -1, -1);
+		const __m128i swapHigh = _mm_setr_epi8(9, 8, -1, -1, 11, 10, -1, -1, 13, 12, -1, -1, 15, 14, -1, -1);
+		// Scale is 1 or 2 for loca, so a shift covers it
+		int shift = scale == 2 ? 1 : 0;
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i values = _mm_loadu_si128((const __m128i*)(src + i * 2));
+			__m128i low = _mm_slli_epi32(_mm_shuffle_epi8(values, swapLow), shift);
+			__m128i high = _mm_slli_epi32(_mm_shuffle_epi8(values, swapHigh), shift);
+			_mm_storeu_si128((__m128i*)(dst + i), low);
+			_mm_storeu_si128((__m128i*)(dst + i + 4), high);
+		}
+		return i;
+	}
+
+	TTF_TARGET_AVX2
+	static size_t decodeBigEndianUint16sToUint32sAvx2(const uint8* src, uint32* dst, size_t count, uint32 scale)
+	{
+		const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+		int shift = scale == 2 ? 1 : 0;
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i values = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i * 2)), swap);
+			__m256i widened = _mm256_slli_epi32(_mm256_cvtepu16_epi32(values), shift);
+			_mm256_storeu_si256((__m256i*)(dst + i), widened);
+		}
+		return i;
+	}
+
+	// 8 points at a time. Each flag is classified into a byte width of 0, 1 or 2, a prefix sum of the widths gives
+	// every point's offset into the coordinate bytes, a shuffle gathers them into 16 bit lanes and a second prefix
+	// sum turns the deltas into coordinates.
+	TTF_TARGET_SSSE3
+	static int decodeGlyphCoordinatesSsse3(const uint8* flags, int numPoints, const uint8*& coords, const uint8* readEnd,
+		int16* dst, uint8 shortFlag, uint8 sameFlag, int16& value)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i shortMask = _mm_set1_epi16(shortFlag);
+		const __m128i sameMask = _mm_set1_epi16(sameFlag);
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i two = _mm_set1_epi16(2);
+		// -128 in a shuffle control byte selects zero
+		const __m128i shortHigh = _mm_set1_epi16((int16)0x8000);
+		const __m128i zeroBoth = _mm_set1_epi16((int16)0x8080);
+
+		__m128i running = _mm_set1_epi16(value);
+		int i = 0;
+		for (; i + 8 <= numPoints && coords + 16 <= readEnd; i += 8)
+		{
+			__m128i flagLanes = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(flags + i)), zero);
+			__m128i isShort = _mm_cmpeq_epi16(_mm_and_si128(flagLanes, shortMask), shortMask);
+			__m128i isSame = _mm_cmpeq_epi16(_mm_and_si128(flagLanes, sameMask), sameMask);
+			__m128i isLong = _mm_andnot_si128(_mm_or_si128(isShort, isSame), _mm_set1_epi16(-1));
+			__m128i isZero = _mm_andnot_si128(isShort, isSame);
+
+			__m128i widths = _mm_or_si128(_mm_and_si128(isShort, one), _mm_and_si128(isLong, two));
+			__m128i ends = _mm_add_epi16(widths, _mm_slli_si128(widths, 2));
+			ends = _mm_add_epi16(ends, _mm_slli_si128(ends, 4));
+			ends = _mm_add_epi16(ends, _mm_slli_si128(ends, 8));
+			__m128i offsets = _mm_sub_epi16(ends, widths);
+
+			// Short values are one byte in the low half, long values are big endian so the low half takes the second byte
+			__m128i shortControl = _mm_or_si128(offsets, shortHigh);
+			__m128i longControl = _mm_or_si128(_mm_add_epi16(offsets, one), _mm_slli_epi16(offsets, 8));
+			__m128i control = _mm_or_si128(_mm_and_si128(isShort, shortControl), _mm_and_si128(isLong, longControl));
+			control = _mm_or_si128(control, _mm_and_si128(isZero, zeroBoth));
+
+			__m128i deltas = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)coords), control);
+
+			// Short values without the same flag are negative
+			__m128i negate = _mm_andnot_si128(isSame, isShort);
+			deltas = _mm_sub_epi16(_mm_xor_si128(deltas, negate), negate);
+
+			deltas = _mm_add_epi16(deltas, _mm_slli_si128(deltas, 2));
+			deltas = _mm_add_epi16(deltas, _mm_slli_si128(deltas, 4));
+			deltas = _mm_add_epi16(deltas, _mm_slli_si128(deltas, 8));
+			__m128i values = _mm_add_epi16(deltas, running);
+			_mm_storeu_si128((__m128i*)(dst + i), values);
+
+			running = _mm_shuffle_epi32(_mm_shufflehi_epi16(values, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+			coords += _mm_extract_epi16(ends, 7);
+		}
+
+		value = (int16)_mm_extract_epi16(running, 0);
+		return i;
+	}
+
+	// A prefix sum within the register takes two shifted adds, then the sum so far is carried into the next one.
+	// Only needs SSE2, but runs on the same tier as the other 128-bit paths.
+	TTF_TARGET_SSSE3
+	static int accumulateCoverageSse(const float* cells, uint8* coverage, int count, float& sum)
+	{
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 maxValue = _mm_set1_ps(255.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		__m128 carry = _mm_set1_ps(sum);
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sums = _mm_loadu_ps(cells + i);
+			sums = _mm_add_ps(sums, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(sums), 4)));
+			sums = _mm_add_ps(sums, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(sums), 8)));
+			sums = _mm_add_ps(sums, carry);
+			carry = _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(3, 3, 3, 3));
+
+			__m128 alpha = _mm_min_ps(_mm_and_ps(sums, absMask), one);
+			__m128i values = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(alpha, maxValue), half));
+			values = _mm_packus_epi16(_mm_packs_epi32(values, values), values);
+			int packed = _mm_cvtsi128_si32(values);
+			memcpy(coverage + i, &packed, 4);
+		}
+
+		sum = _mm_cvtss_f32(carry);
+		return i;
+	}
+
+	// Same as the SSE path, with the low half's total added to the high half in between
+	TTF_TARGET_AVX2
+	static int accumulateCoverageAvx2(const float* cells, uint8* coverage, int count, float& sum)
+	{
+		const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 maxValue = _mm256_set1_ps(255.0f);
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256i lastLane = _mm256_set1_epi32(7);
+
+		__m256 carry = _mm256_set1_ps(sum);
+		int i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sums = _mm256_loadu_ps(cells + i);
+			sums = _mm256_add_ps(sums, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(sums), 4)));
+			sums = _mm256_add_ps(sums, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(sums), 8)));
+			__m256 lowTotal = _mm256_permute_ps(sums, _MM_SHUFFLE(3, 3, 3, 3));
+			sums = _mm256_add_ps(sums, _mm256_permute2f128_ps(lowTotal, lowTotal, 0x08));
+			sums = _mm256_add_ps(sums, carry);
+			carry = _mm256_permutevar8x32_ps(sums, lastLane);
+
+			__m256 alpha = _mm256_min_ps(_mm256_and_ps(sums, absMask), one);
+			__m256i values = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(alpha, maxValue), half));
+			values = _mm256_packus_epi16(_mm256_packs_epi32(values, values), values);
+			int low = _mm_cvtsi128_si32(_mm256_castsi256_si128(values));
+			int high = _mm_cvtsi128_si32(_mm256_extracti128_si256(values, 1));
+			memcpy(coverage + i, &low, 4);
+			memcpy(coverage + i + 4, &high, 4);
+		}
+
+		sum = _mm256_cvtss_f32(carry);
+		return i;
+	}
+#else
+	bool cpuHasSsse3() { return false; }
+	bool cpuHasAvx2() { return false; }
+#endif
+
+	void decodeBigEndianUint32s(const uint8* src, uint32* dst, size_t count)
+	{
+		size_t i = 0;
+#if TTF_X86
+		if (cpuHasAvx2())
+		{
+			i = decodeBigEndianUint32sAvx2(src, dst, count);
+		}
+		else if (cpuHasSsse3())
+		{
+			i = decodeBigEndianUint32sSsse3(src, dst, count);
+		}
+#endif
+		// Scalar tail, or everything if there is no SIMD support
+		for (; i < count; i++)
+		{
+			const uint8* p = src + i * 4;
+			dst[i] = ((uint32)p[0] << 24) | ((uint32)p[1] << 16) | ((uint32)p[2] << 8) | (uint32)p[3];
+		}
+	}
+
+	void decodeBigEndianUint16sToUint32s(const uint8* src, uint32* dst, size_t count, uint32 scale)
+	{
+		size_t i = 0;
+#if TTF_X86
+		if (scale == 1 || scale == 2)
+		{
+			if (cpuHasAvx2())
+			{
+				i = decodeBigEndianUint16sToUint32sAvx2(src, dst, count, scale);
+			}
+			else if (cpuHasSsse3())
+			{
+				i = decodeBigEndianUint16sToUint32sSsse3(src, dst, count, scale);
+			}
+		}
+#endif
+		for (; i < count; i++)
+		{
+			const uint8* p = src + i * 2;
+			dst[i] = (((uint32)p[0] << 8) | (uint32)p[1]) * scale;
+		}
+	}
+
+	const uint8* decodeGlyphCoordinates(const uint8* flags, int numPoints, const uint8* coords, const uint8* readEnd,
+		int16* dst, uint8 shortFlag, uint8 sameFlag)
+	{
+		int16 value = 0;
+		int i = 0;
+#if TTF_X86
+		if (cpuHasSsse3())
+		{
+			i = decodeGlyphCoordinatesSsse3(flags, numPoints, coords, readEnd, dst, shortFlag, sameFlag, value);
+		}
+#endif
+		for (; i < numPoints; i++)
+		{
+			value += readGlyphCoordinateDelta(flags[i], coords, shortFlag, sameFlag);
+			dst[i] = value;
+		}
+		return coords;
+	}
+
+	void accumulateCoverage(const float* cells, uint8* coverage, int count)
+	{
+		float sum = 0.0f;
+		int i = 0;
+#if TTF_X86
+		if (cpuHasAvx2())
+		{
+			i = accumulateCoverageAvx2(cells, coverage, count, sum);
+		}
+		else if (cpuHasSsse3())
+		{
+			i = accumulateCoverageSse(cells, coverage, count, sum);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			sum += cells[i];
+			float alpha = fabsf(sum);
+			alpha = alpha < 1.0f ? alpha : 1.0f;
+			coverage[i] = (uint8)(alpha * 255.0f + 0.5f);
+		}
+	}
+}
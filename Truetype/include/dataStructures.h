@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef _DEBUG
 #include <assert.h>
@@ -25,6 +26,122 @@ namespace Truetype
 	typedef uint16 Offset16;
 	typedef uint32 Offset32;
 
+	// A read-only view of a file that the OS pages in on demand. Only the pages
+	// that are actually touched become resident.
+	struct MappedFile
+	{
+		char* data;
+		size_t size;
+		void* fileHandle;
+		void* mappingHandle;
+	};
+
+	enum class FontLoadMode : uint8
+	{
+		Copy,       // Read the whole file into a malloc'd buffer
+		MemoryMap   // Map the file read-only
+	};
+
+	// Every table the library knows about. Tables that are not listed here are skipped when the
+	// table directory is indexed.
+	enum class TableType : uint8
+	{
+		Cmap,
+		Glyf,
+		Head,
+		Hhea,
+		Hmtx,
+		Loca,
+		Maxp,
+		Name,
+		Os2,
+		Post,
+		Kern,
+		Gpos,
+		Gsub,
+		Fpgm,
+		Prep,
+		Cvt,
+		Svg,
+		Length
+	};
+
+	struct TableRecord
+	{
+		uint32 offset;         // Offset from the start of the .ttf file, 0 if the table is not present
+		uint32 length;
+	};
+
+	struct TableDirectory
+	{
+		TableRecord records[(int)TableType::Length];
+		uint32 presentMask;    // Bit (1 << TableType) is set if the table exists and lies inside the file
+	};
+
+	// A cmap format 4 segment decoded to native endianness
+	struct CmapSegment
+	{
+		uint16 startCode;
+		uint16 endCode;
+		uint16 idDelta;
+		uint32 glyphIdArray;   // Offset from the start of the .ttf file to the glyph id of startCode, 0 if idDelta is used instead
+	};
+
+	// Optional work initFont can do up front to make later lookups faster
+	enum InitFlags : uint32
+	{
+		INIT_DEFAULT = 0,
+		INIT_GLYPH_PAGE_TABLE = 1 << 0,  // Build a page table that maps every codepoint to its glyph id with two loads
+		INIT_DECODE_LOCA = 1 << 1,       // Decode the loca table into native uint32 glyph offsets
+		INIT_CACHE_COMPOSITES = 1 << 2,  // Flatten every composite glyph once so decoding one is a copy
+		INIT_DECODE_HMTX = 1 << 3        // Decode the hmtx table into a native advance and lsb for every glyph
+	};
+
+	// A cmap format 12 or 13 sequential map group decoded to native endianness
+	struct CmapGroup
+	{
+		uint32 startCharCode;
+		uint32 endCharCode;
+		uint32 startGlyphId;   // Format 13 maps the whole range to this glyph
+	};
+
+	// Horizontal metrics of one glyph, in font units
+	struct HorizontalMetrics
+	{
+		uint16 advanceWidth;
+		int16 leftSideBearing;
+	};
+
+	constexpr uint16 GPOS_NOT_COVERED = 0xFFFF;
+
+	// A GPOS PairPos format 2 subtable flattened at load. The class of the first glyph also says whether the
+	// subtable covers it, so a pair takes one load per glyph and one from the matrix.
+	struct GposClassSubtable
+	{
+		int subtableIndex;        // Position in its lookup, subtables earlier in a lookup take precedence
+		uint16 firstGlyph;        // class1 covers glyphs [firstGlyph, firstGlyph + numGlyphs)
+		uint16 numGlyphs;
+		uint16* class1;           // GPOS_NOT_COVERED for glyphs outside the coverage table
+		uint16 firstClass2Glyph;  // class2 covers glyphs [firstClass2Glyph, firstClass2Glyph + numClass2Glyphs), others are class 0
+		uint16 numClass2Glyphs;
+		uint16* class2;
+		int class2Count;
+		int16* values;            // x advance of the first glyph for every class1 * class2Count + class2
+	};
+
+	// The PairPos subtables of one GPOS lookup. Format 1 pairs are hashed like the kern table.
+	struct GposPairLookup
+	{
+		uint32* pairKeys;         // (left << 16) | right, 0xFFFFFFFF in empty slots
+		int16* pairValues;
+		uint16* pairSubtables;    // Which subtable each pair came from
+		int pairShift;
+		int numPairs;
+
+		GposClassSubtable* classSubtables; // In subtable order
+		int numClassSubtables;
+	};
+
 	struct Buffer
 	{
 		char* data;
@@ -32,22 +149,282 @@ namespace Truetype
 		int size;
 	};
 
+	struct GlyphData
+	{
+		int16 numContours;
+		uint16* contourEnds;
+		uint16 numPoints;
+		uint16* flags;
+		int16* xCoords;
+		int16* yCoords;
+	};
+
+	// Per point flags of a simple glyph
+	enum SimpleGlyphFlag : uint8
+	{
+		ON_CURVE = 0x01,
+		X_IS_BYTE = 0x02,
+		Y_IS_BYTE = 0x04,
+		REPEAT = 0x08,
+		X_DELTA = 0x10,   // With X_IS_BYTE the byte is positive, without it x is the same as the previous point
+		Y_DELTA = 0x20
+	};
+
+	// Flags of a composite glyph's component records
+	enum ComponentFlag : uint16
+	{
+		ARG_1_AND_2_ARE_WORDS = 0x0001,
+		ARGS_ARE_XY_VALUES = 0x0002,
+		WE_HAVE_A_SCALE = 0x0008,
+		MORE_COMPONENTS = 0x0020,
+		WE_HAVE_AN_X_AND_Y_SCALE = 0x0040,
+		WE_HAVE_A_TWO_BY_TWO = 0x0080,
+		SCALED_COMPONENT_OFFSET = 0x0800,
+		UNSCALED_COMPONENT_OFFSET = 0x1000
+	};
+
+	// Composites nested deeper than this are treated as broken
+	constexpr int MAX_COMPONENT_DEPTH = 16;
+
+	// Where the parts of a simple glyph start in the font data. Every span has been bounds checked.
+	struct SimpleGlyphLayout
+	{
+		int numContours;
+		int numPoints;
+		const uint8* contourEnds; // Big endian uint16s
+		const uint8* flags;       // Run length encoded
+		const uint8* xCoords;
+		const uint8* yCoords;
+	};
+
+	// Component transform, x' = a * x + c * y and y' = b * x + d * y
+	struct ComponentMatrix
+	{
+		float a, b, c, d;
+	};
+
+	// One component record of a composite glyph
+	struct GlyphComponent
+	{
+		uint16 flags;
+		uint16 glyphId;
+		int arg1, arg2; // An offset with ARGS_ARE_XY_VALUES, otherwise the point numbers to match
+		ComponentMatrix matrix;
+	};
+
+	enum class SegmentType : uint8
+	{
+		Line,
+		Quad
+	};
+
+	// A line or quadratic bezier in font units. Lines have the control point on their start point, which is still
+	// exactly a straight line if they are evaluated as a quad.
+	struct Segment
+	{
+		SegmentType type;
+		int16 x0, y0;
+		int16 cx, cy;
+		int16 x1, y1;
+	};
+
+	// The segments of an outline in contour order. Contour c is segments [contourEnds[c - 1], contourEnds[c]).
+	struct GlyphSegments
+	{
+		int16 numContours;
+		uint16* contourEnds;
+		int numSegments;
+		Segment* segments;
+	};
+
+	struct PolylinePoint
+	{
+		float x, y;
+	};
+
+	// An outline flattened to straight lines, in pixels. Contour c is points [contourEnds[c - 1], contourEnds[c]) and
+	// ends on its first point, so every contour is closed.
+	struct GlyphPolyline
+	{
+		int16 numContours;
+		int* contourEnds;
+		int numPoints;
+		PolylinePoint* points;
+	};
+
+	// An outline split into curves that only rise or only fall in y, kept as polynomial coefficients in font units
+	// times scale. Curve i is x(t) = (ax * t + bx) * t + cx and y(t) = (ay * t + by) * t + cy for t in [0, 1].
+	// The horizontal line at y crosses it once if minY <= y < maxY, with winding -1 for rising curves and +1 for
+	// falling ones. Curves are sorted by minY and horizontal ones are left out, since nothing crosses them.
+	struct PreparedOutline
+	{
+		float scale;
+		int numCurves;
+		float* minY;
+		float* maxY;
+		float* ax;
+		float* bx;
+		float* cx;
+		float* ay;
+		float* by;
+		float* cy;
+		int8* winding;
+	};
+
+	// How a glyph lands on the pixel grid. Font units are scaled to pixelsPerEm, transformed by the matrix and moved
+	// by the subpixel offset from the pen position.
+	struct GlyphPlacement
+	{
+		float pixelsPerEm;
+		float subpixelX, subpixelY;
+		ComponentMatrix matrix;
+	};
+
+	enum class PixelFormat : uint8
+	{
+		Alpha8, // One byte of coverage per pixel
+		Mono1   // One bit per pixel, most significant bit first, set where coverage is at least half
+	};
+
+	// Coverage of a placed glyph. The bottom left corner is at pixel (x, y) from the pen position. pixels points at
+	// the bottom row and stride is the bytes from a row to the one above it, negative for memory stored top down.
+	struct GlyphBitmap
+	{
+		int x, y;
+		int width, height;
+		uint8* pixels;
+		int stride;
+		PixelFormat format;
+	};
+
+	struct FontInfo;
+
+	// A composite glyph the segment iterator is inside of
+	struct ComponentCursor
+	{
+		const uint8* next; // The next component record, nullptr after the last one
+		ComponentMatrix matrix;
+		int16 offsetX, offsetY;
+	};
+
+	// Walks a glyph's segments straight out of the glyf table. Set up with beginGlyphSegments.
+	struct SegmentIterator
+	{
+		const FontInfo* fontInfo;
+		bool failed; // Iteration stopped on a glyph that couldn't be read
+
+		// The simple glyph being read and where it is placed
+		SimpleGlyphLayout layout;
+		ComponentMatrix matrix;
+		bool transformed;
+		int16 offsetX, offsetY;
+
+		// Position in the point stream
+		int point;
+		int contour;
+		int contourEnd;
+		uint8 flag;
+		uint8 flagRepeat;
+		int16 x, y;
+
+		// Position in the current contour, in the simple glyph's own units
+		bool inContour;
+		bool startOffCurve;
+		bool hasControl;
+		int16 startX, startY;               // The first on curve point, where the contour closes
+		int16 startControlX, startControlY; // The off curve point before it, if the contour started off curve
+		int16 currentX, currentY;
+		int16 controlX, controlY;
+
+		int depth;
+		ComponentCursor components[MAX_COMPONENT_DEPTH];
+	};
+
+	struct ArenaBlock
+	{
+		ArenaBlock* next;
+		size_t size; // Usable bytes after the header
+		size_t used;
+	};
+
+	// Bump allocator for data that lives and dies together, like a frame's or a font's decoded glyphs.
+	// Blocks are kept when the arena is reset, so a warmed up arena stops allocating.
+	struct Arena
+	{
+		ArenaBlock* first;
+		ArenaBlock* current;
+		size_t blockSize;
+
+		size_t bytesUsed;
+		size_t bytesReserved;
+		size_t peakBytesUsed;
+		int numBlocks;
+		int numBlocksUsed;
+		int peakBlocksUsed;
+		int numAllocations;
+	};
+
+	struct ArenaMarker
+	{
+		ArenaBlock* block;
+		size_t blockUsed;
+		size_t bytesUsed;
+		int numBlocksUsed;
+	};
+
 	struct FontInfo
 	{
 		void* userdata;
 		char* data;            // Pointer to .ttf file
-		int fontStart;         // Offset to beginning of font
+		int fontStart;         // Offset to the font's table directory, past the header of a .ttc collection
 		int fontSize;          // Size of data pointer
 
 		int numGlyphs;
+		int maxPoints, maxContours;                   // Largest simple glyph, from maxp or the glyph headers if maxp doesn't have it
+		int maxCompositePoints, maxCompositeContours; // Largest composite glyph once flattened
+		int maxComponentElements, maxComponentDepth;
 
 		int loca, head, glyf, hhea, hmtx, kern, gpos, svg; // Table locations offset from start of .ttf file
 		int indexMap;          // a cmap mapping for our chosen character encoding
 		int indexToLocFormat;  // Format needed to map from glyph index to glyph
 		int cmap;              // Offset to cmap table that is in a version we would like to parse
+		int cmapFormat;
+
+		CmapSegment* cmapSegments; // Format 4. Sorted by endCode, so a codepoint can be found with a binary search
+		int numCmapSegments;
+		CmapGroup* cmapGroups;     // Format 12 and 13. Sorted by endCharCode
+		int numCmapGroups;
+
+		uint16 latin1Page[256];    // Glyph ids for codepoints 0-255, always resident
+		uint16** glyphPages;       // Only built with INIT_GLYPH_PAGE_TABLE. glyphPages[c >> 8][c & 0xFF], pages without glyphs are nullptr. Page 0 is latin1Page, glyphPages[0] stays nullptr
+		int numGlyphPages;
+
+		uint32* glyphOffsets;      // Only built with INIT_DECODE_LOCA. numGlyphs + 1 offsets into the glyf table
+
+		GlyphData* compositeGlyphs; // Only built with INIT_CACHE_COMPOSITES. Flattened outline of every composite glyph by id, empty for the others
+		Arena compositeArena;       // Holds the compositeGlyphs outlines
 
 		int xMin, yMin, xMax, yMax;
 		int unitsPerEm;
+
+		int ascender, descender, lineGap; // From hhea, 0 if the font has none
+		int advanceWidthMax;
+		int numberOfHMetrics;             // Glyphs from here on only store a lsb and share the last advance
+		HorizontalMetrics* horizontalMetrics; // Only built with INIT_DECODE_HMTX. Metrics of every glyph by id
+
+		uint32* kernKeys;      // Hash table of the kern table's pairs as (left << 16) | right, 0xFFFFFFFF in empty slots
+		int16* kernValues;     // Shares the kernKeys allocation
+		int numKernPairs;
+		int kernShift;         // 32 minus log2 of the number of slots
+
+		GposPairLookup* gposLookups; // Pair adjustment lookups of the GPOS 'kern' feature, in lookup list order
+		int numGposLookups;
+		Arena gposArena;             // Holds the gposLookups and everything they point to
+
+		TableDirectory tables;
+
+		FontLoadMode loadMode; // How `data` was acquired, so freeFont knows how to release it
+		MappedFile mapping;    // Only valid if loadMode is FontLoadMode::MemoryMap
 	};
 
 	struct Glyph
@@ -60,15 +437,31 @@ namespace Truetype
 
 		uint8* simpleGlyphTable = nullptr;
 		uint8* compositeGlyphTable = nullptr;
+		uint16 id = 0;
 	};
 
-	struct GlyphData
+
+	// Working memory for decoding glyphs without allocating, sized from maxp by createGlyphScratch.
+	// The raw arrays hold the points as stored in the glyf table, the others hold the decoded GlyphData.
+	struct GlyphScratch
 	{
-		int16 numContours;
+		int pointCapacity;
+		int contourCapacity;
+		int outputCapacity; // pointCapacity plus the implied on curve points and one closing point per contour
+
+		uint8* rawFlags;
+		int16* rawXCoords;
+		int16* rawYCoords;
+
+		// A composite's component points as numbered in the glyf table, for components placed by matching points
+		int16* originalXCoords;
+		int16* originalYCoords;
+
 		uint16* contourEnds;
-		uint16 numPoints;
 		uint16* flags;
 		int16* xCoords;
 		int16* yCoords;
+
+		void* memory;
 	};
 }
\ No newline at end of file
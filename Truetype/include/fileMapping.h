@@ -0,0 +1,14 @@
+#pragma once
+#include "dataStructures.h"
+
+namespace Truetype
+{
+	// Maps a file read-only. On failure the returned file has data == nullptr.
+	MappedFile mapFile(const char* filepath);
+
+	void unmapFile(MappedFile& file);
+
+	// Reads the whole file into a malloc'd buffer. On failure the returned file has data == nullptr.
+	// The handles are unused, release the data with free().
+	MappedFile readFileCopy(const char* filepath);
+}
@@ -6,30 +6,98 @@
 #include "readData.h"
 #include "writeData.h"
 #include "dataStructures.h"
+#include "fileMapping.h"
+#include "memory.h"
 
 #include "stb_write.h"
 
 namespace Truetype
 {
+	// Scans the table directory for tag. Returns 0 if the table does not exist.
 	uint32 findTableOffset(const char* fontData, const char* tag);
 
-	uint32 getGlyphId(uint16 character, const FontInfo& fontInfo);
+	bool hasTable(const FontInfo& fontInfo, TableType table);
 
-	Glyph getGlyph(uint16 character, const FontInfo& fontInfo);
+	// The offset and length of a table from the directory indexed in initFont. Both are 0 if the table is not present.
+	const TableRecord& getTable(const FontInfo& fontInfo, TableType table);
 
+	uint32 getGlyphId(uint32 codepoint, const FontInfo& fontInfo);
+
+	// Maps a whole run of codepoints to glyph ids at once. Much faster than calling getGlyphId for every codepoint.
+	void getGlyphIds(const uint32* codepoints, size_t numCodepoints, uint16* glyphIds, const FontInfo& fontInfo);
+
+	Glyph getGlyph(uint32 codepoint, const FontInfo& fontInfo);
+
+	Glyph getGlyphById(uint32 glyphId, const FontInfo& fontInfo);
+
+	// Size of the glyph's data in the glyf table. 0 means the glyph is empty.
+	uint32 getGlyphSize(uint32 glyphId, const FontInfo& fontInfo);
+
+	// Finds the contour ends, flags and coordinates of a simple glyph. Returns false if the glyph is not simple, its
+	// contour ends are not strictly increasing or its data runs past the end of the font.
+	bool getSimpleGlyphLayout(const Glyph& glyph, const FontInfo& fontInfo, SimpleGlyphLayout& layout);
+
+	// Reads the component record at the buffer's cursor. Returns false if it runs past the end of the font.
+	bool readGlyphComponent(Buffer& buffer, GlyphComponent& component);
+
+	// The transform from a component's units to the top level glyph's, given the transform of its parent
+	ComponentMatrix combineComponentMatrices(const ComponentMatrix& parent, const ComponentMatrix& component);
+
+	// Where an ARGS_ARE_XY_VALUES component is moved to, rounded to font units
+	void getComponentOffset(const GlyphComponent& component, const ComponentMatrix& parent, const ComponentMatrix& combined,
+		int16& offsetX, int16& offsetY);
+
+	// Applies a component transform to a point, rounding to font units
+	void transformPoint(const ComponentMatrix& matrix, int16& x, int16& y);
+
+	// Composite glyphs are flattened into the same outline format as simple glyphs
 	GlyphData getGlyphData(const Glyph& glyph, const FontInfo& fontInfo);
 
+	// Decodes into the scratch memory without allocating. The returned arrays point into the scratch and stay valid
+	// until the next decode with it, do not call freeGlyphData on them. Glyphs too large for the scratch come back empty.
+	GlyphData getGlyphData(const Glyph& glyph, const FontInfo& fontInfo, GlyphScratch& scratch);
+
+	// Decodes into memory from the arena, which is released along with the rest of the arena
+	GlyphData getGlyphData(const Glyph& glyph, const FontInfo& fontInfo, Arena& arena);
+
+	// Sized for the largest glyph in the font according to maxp
+	GlyphScratch createGlyphScratch(const FontInfo& fontInfo);
+	GlyphScratch createGlyphScratch(const FontInfo& fontInfo, Arena& arena);
+
+	GlyphScratch createGlyphScratch(int maxPoints, int maxContours);
+	GlyphScratch createGlyphScratch(int maxPoints, int maxContours, Arena& arena);
+
+	void freeGlyphScratch(GlyphScratch& scratch);
+
 	void freeGlyphData(GlyphData& glyph);
 
-	void drawCompositeGlyph(const Glyph& glyph);
+	// Encodes a single channel PNG of the bitmap with its bottom row last. 1-bit bitmaps are written as 0 or 255.
+	// Returns false if the bitmap is empty or the file could not be written.
+	bool writeGlyphBitmap(const GlyphBitmap& bitmap, const char* fileLocation);
+
+	void drawCompositeGlyph(const Glyph& glyph, const FontInfo& fontInfo, const char* fileLocation);
+
+	void drawGlyph(uint32 codepoint, const FontInfo& fontInfo, const char* fileLocation = "glyph.png");
+
+	// Number of fonts in the file: the count from the header of a .ttc collection, otherwise 1
+	int getNumFonts(const char* fontData, int fontSize);
+
+	// Expects fontData to be allocated with malloc, freeFont will free it. fontIndex picks the font out of a .ttc
+	// collection. Returns false if there is no such font or it is missing a table that is required to read glyphs.
+	bool initFont(FontInfo& fontInfo, char* fontData, int fontSize, uint32 initFlags = INIT_DEFAULT, int fontIndex = 0);
 
-	void drawGlyph(uint16 codepoint, const FontInfo& fontInfo, const char* fileLocation = "glyph.png");
+	// Opens the font at filepath and initializes fontInfo with it. Returns false if the file could not be loaded.
+	bool loadFont(FontInfo& fontInfo, const char* filepath, FontLoadMode mode = FontLoadMode::MemoryMap, uint32 initFlags = INIT_DEFAULT,
+		int fontIndex = 0);
 
-	void initFont(FontInfo& fontInfo, char* fontData, int fontSize);
+	// Bytes allocated by the library for this font, not counting the font file itself
+	size_t getFontMemoryUsage(const FontInfo& fontInfo);
 
 	bool checkCompatibility(FontInfo& fontInfo);
 
-	uint32 writeInternalFont(FontInfo& fontInfo, const char* fontToWrite);
+	// Converts every glyph to the flattened format the shaders read. With numThreads > 1 the glyphs are decoded in
+	// parallel, 0 uses one thread per core. The output is the same whatever the thread count.
+	uint32 writeInternalFont(FontInfo& fontInfo, const char* fontToWrite, int numThreads = 1);
 
 	void parseFont(FontInfo& fontInfo);
 
@@ -0,0 +1,35 @@
+#pragma once
+#include "dataStructures.h"
+
+namespace Truetype
+{
+	// Decoded outlines keyed by (font, glyph id), shared between threads. The cache is split into shards that each
+	// have their own lock and least recently used list, so threads looking up different glyphs rarely wait on
+	// each other.
+	struct GlyphCache;
+
+	struct GlyphCacheStats
+	{
+		uint64 hits;
+		uint64 misses;
+		uint64 evictions;
+		size_t bytesUsed;
+		size_t byteBudget;
+		int numEntries;
+	};
+
+	// byteBudget is split evenly between the shards. numShards is rounded up to a power of two.
+	GlyphCache* createGlyphCache(size_t byteBudget, int numShards = 16);
+
+	void freeGlyphCache(GlyphCache* cache);
+
+	// Copies the cached outline into the scratch, or decodes it into the scratch and caches a copy on a miss.
+	// The result has the same lifetime as getGlyphData(glyph, fontInfo, scratch).
+	GlyphData getGlyphData(GlyphCache& cache, const Glyph& glyph, const FontInfo& fontInfo, GlyphScratch& scratch);
+
+	// Drops every glyph of a font. Call this before freeing a font the cache has seen, since a new font
+	// could be loaded at the same address.
+	void evictFont(GlyphCache& cache, const FontInfo& fontInfo);
+
+	GlyphCacheStats getGlyphCacheStats(GlyphCache& cache);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "dataStructures.h"
+
+namespace Truetype
+{
+	typedef void* (*AllocateFn)(size_t numBytes, void* userdata);
+	typedef void (*DeallocateFn)(void* memory, void* userdata);
+
+	// Every allocation the library makes goes through these, except for font files which belong to the caller.
+	// Defaults to malloc and free. Set this before loading any fonts.
+	void setAllocator(AllocateFn allocateFn, DeallocateFn deallocateFn, void* userdata = nullptr);
+
+	void* allocate(size_t numBytes);
+	void* allocateZeroed(size_t numBytes);
+	void deallocate(void* memory);
+
+	Arena createArena(size_t blockSize = 64 * 1024);
+
+	// Never returns memory that has to be freed on its own, everything goes away with resetArena or freeArena
+	void* arenaAllocate(Arena& arena, size_t numBytes, size_t alignment = 8);
+
+	// Everything allocated after the marker is released
+	ArenaMarker getArenaMarker(const Arena& arena);
+	void rewindArena(Arena& arena, const ArenaMarker& marker);
+
+	// Releases everything in O(1) but keeps the blocks for reuse
+	void resetArena(Arena& arena);
+
+	// Gives the blocks back to the allocator
+	void freeArena(Arena& arena);
+}
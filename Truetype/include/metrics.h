@@ -0,0 +1,30 @@
+#pragma once
+#include "dataStructures.h"
+
+namespace Truetype
+{
+	// Reads the hhea header into fontInfo, and decodes hmtx too if decodeHmtx is set. Called by initFont.
+	void initHorizontalMetrics(FontInfo& fontInfo, bool decodeHmtx);
+
+	// Advance width and left side bearing of a glyph in font units. A table lookup when the font was initialized
+	// with INIT_DECODE_HMTX, otherwise read from hmtx. Glyphs outside the table get zeroes.
+	HorizontalMetrics getHorizontalMetrics(uint32 glyphId, const FontInfo& fontInfo);
+
+	// Decodes the horizontal format 0 subtables of the kern table into a pair table. Called by initFont.
+	void initKerning(FontInfo& fontInfo);
+
+	// Decodes the pair adjustment lookups of the GPOS 'kern' feature. Called by initFont.
+	void initGposKerning(FontInfo& fontInfo);
+
+	// Kerning between two glyphs in font units, 0 if the pair isn't kerned. Uses GPOS if the font has pair
+	// adjustments there, and the kern table otherwise.
+	int getKerning(uint32 leftGlyphId, uint32 rightGlyphId, const FontInfo& fontInfo);
+
+	// Kerning from one source only
+	int getKernTableKerning(uint32 leftGlyphId, uint32 rightGlyphId, const FontInfo& fontInfo);
+	int getGposKerning(uint32 leftGlyphId, uint32 rightGlyphId, const FontInfo& fontInfo);
+
+	// Kerning between every glyph of a run and the one after it. kerning[count - 1] is always 0, so the result can
+	// be added straight onto the advances.
+	void getKerning(const uint16* glyphIds, size_t count, int16* kerning, const FontInfo& fontInfo);
+}
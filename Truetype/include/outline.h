@@ -0,0 +1,51 @@
+#pragma once
+#include "dataStructures.h"
+
+namespace Truetype
+{
+	// Number of segments getGlyphSegments will produce
+	int countGlyphSegments(const GlyphData& glyphData);
+
+	// Turns the points and on curve flags into explicit lines and quads, so consumers don't have to look at flags.
+	// Free the result with freeGlyphSegments.
+	GlyphSegments getGlyphSegments(const GlyphData& glyphData);
+
+	// Same, but the result lives in the arena
+	GlyphSegments getGlyphSegments(const GlyphData& glyphData, Arena& arena);
+
+	// Decodes the glyph into the scratch and writes its segments to the arena, without touching the allocator
+	// once the arena is warm
+	GlyphSegments getGlyphSegments(const Glyph& glyph, const FontInfo& fontInfo, GlyphScratch& scratch, Arena& arena);
+
+	void freeGlyphSegments(GlyphSegments& segments);
+
+	// How many lines a segment is split into so no point on it is further than tolerance pixels from them, at scale
+	// pixels per font unit. A quad split evenly into n lines is at most |p0 - 2 * p1 + p2| / (4 * n * n) from them,
+	// so the count comes straight from that instead of subdividing recursively.
+	int getSegmentSubdivisions(const Segment& segment, float scale, float tolerance);
+
+	// Bytes flattenGlyphSegments needs for these segments
+	size_t getGlyphPolylineSize(const GlyphSegments& segments, float scale, float tolerance);
+
+	// Flattens the segments into memory, which has to hold getGlyphPolylineSize bytes and be aligned for floats.
+	// Points are the font units times scale. The segments can be flattened again at other scales.
+	GlyphPolyline flattenGlyphSegments(const GlyphSegments& segments, float scale, float tolerance, void* memory);
+
+	// Same, but the result lives in the arena
+	GlyphPolyline flattenGlyphSegments(const GlyphSegments& segments, float scale, float tolerance, Arena& arena);
+
+	// Splits every quad at its highest or lowest point and stores the curves' coefficients at scale pixels per font
+	// unit, so the raster and distance code can solve for crossings without going back to the points. Build it once
+	// per glyph and size and reuse it for every render. It lives in the arena.
+	PreparedOutline prepareGlyphOutline(const GlyphSegments& segments, float scale, Arena& arena);
+
+	// Sets up the iterator to walk the glyph's segments straight from the glyf table, decoding flags and deltas as
+	// it goes. Nothing is allocated, and the segments come out in the same order and with the same coordinates as
+	// getGlyphSegments gives. Meant for consumers that only need one pass over the outline.
+	void beginGlyphSegments(SegmentIterator& iterator, const Glyph& glyph, const FontInfo& fontInfo);
+
+	// Writes the next segment and returns true, or returns false at the end of the outline. Components placed by
+	// matching points need the points of the components before them, which the iterator doesn't keep, so those and
+	// glyphs that can't be read stop the iteration with failed set. Use getGlyphSegments for them instead.
+	bool nextGlyphSegment(SegmentIterator& iterator, Segment& segment);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "dataStructures.h"
+
+namespace Truetype
+{
+	// Hard edged rasterization with the non-zero rule. The width by height bitmap stretches over the glyph's box and
+	// pixel (x, y) is 255 if the font unit point it maps to is inside the outline, 0 otherwise. Row 0 is at yMin.
+	// A point is inside if the curves crossing the horizontal line through it at or to the right of it don't sum
+	// to zero winding. Both paths read a prepared outline, which can be built once and rendered at any bitmap size.
+	// The font unit sample points are multiplied by the outline's scale to meet it.
+
+	// Reference path: tests every pixel against every curve, so it costs pixels * curves crossing solves
+	void rasterizeGlyphWinding(const PreparedOutline& outline, const Glyph& glyph, int width, int height, uint8* pixels);
+
+	// Same, preparing the outline in the arena and releasing it before returning
+	void rasterizeGlyphWinding(const GlyphSegments& segments, const Glyph& glyph, int width, int height, uint8* pixels, Arena& arena);
+
+	// Same pixels from a scanline sweep. The outline's curves are already sorted by their lowest point, so they are
+	// added to an active edge table as the rows go up, and each row solves for the crossings of the active curves
+	// once and fills the spans between them. Scratch comes from the arena and is released before returning.
+	void rasterizeGlyphScanline(const PreparedOutline& outline, const Glyph& glyph, int width, int height, uint8* pixels, Arena& arena);
+
+	// Same, preparing the outline in the arena as well
+	void rasterizeGlyphScanline(const GlyphSegments& segments, const Glyph& glyph, int width, int height, uint8* pixels, Arena& arena);
+
+	// Anti-aliased coverage from signed area accumulation. Every line of the polyline adds the area it covers to the
+	// cells of the rows it crosses, and a prefix sum along each row turns that into exact coverage. Pixel (x, y) of
+	// the bitmap covers [x, x + 1) by [y, y + 1) once the offset is added to the polyline's points. Parts of the
+	// outline outside the bitmap are clipped, and only the bytes of the bitmap's rows are written, so it can point
+	// into an atlas page or any other surface. Scratch comes from the arena and is released before returning.
+	void rasterizeGlyphCoverage(const GlyphPolyline& polyline, float offsetX, float offsetY, const GlyphBitmap& bitmap, Arena& arena);
+
+	// Same, into width * height bytes of 8-bit alpha with row 0 at the bottom
+	void rasterizeGlyphCoverage(const GlyphPolyline& polyline, float offsetX, float offsetY, int width, int height, uint8* pixels, Arena& arena);
+
+	// Bytes one row of pixels takes in the format, not counting any padding the stride adds
+	int getBitmapRowBytes(int width, PixelFormat format);
+
+	// Placement for text at pixelsPerEm, optionally transformed by a 2x2 matrix
+	GlyphPlacement createGlyphPlacement(float pixelsPerEm, float subpixelX = 0.0f, float subpixelY = 0.0f);
+	GlyphPlacement createGlyphPlacement(float pixelsPerEm, const ComponentMatrix& matrix, float subpixelX = 0.0f, float subpixelY = 0.0f);
+
+	// The smallest pixel box that holds the glyph's bounding box once placed. The pixels are left null, with a stride
+	// for tightly packed 8-bit alpha. Glyphs without an outline get an empty box.
+	GlyphBitmap getGlyphBitmapBox(const Glyph& glyph, const FontInfo& fontInfo, const GlyphPlacement& placement);
+
+	// Anti-aliased coverage of the placed glyph into memory the caller owns. Take the box from getGlyphBitmapBox,
+	// then point pixels, stride and format at the destination. A smaller box renders just that window of the glyph,
+	// for tiles. Decoding and flattening scratch comes from the arena and is released before returning.
+	void rasterizeGlyph(const Glyph& glyph, const FontInfo& fontInfo, const GlyphPlacement& placement, const GlyphBitmap& bitmap, Arena& arena);
+
+	// Same, but tightly packed pixels are allocated from the arena and stay there
+	GlyphBitmap rasterizeGlyph(const Glyph& glyph, const FontInfo& fontInfo, const GlyphPlacement& placement, Arena& arena,
+		PixelFormat format = PixelFormat::Alpha8);
+}
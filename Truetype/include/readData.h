@@ -1,6 +1,18 @@
 #pragma once
+#include <string.h>
 #include "dataStructures.h"
 
+#ifdef _MSC_VER
+#include <stdlib.h>
+#define TTF_BSWAP16(x) _byteswap_ushort(x)
+#define TTF_BSWAP32(x) _byteswap_ulong(x)
+#define TTF_BSWAP64(x) _byteswap_uint64(x)
+#else
+#define TTF_BSWAP16(x) __builtin_bswap16(x)
+#define TTF_BSWAP32(x) __builtin_bswap32(x)
+#define TTF_BSWAP64(x) __builtin_bswap64(x)
+#endif
+
 #define getFWord     getInt16
 #define getUFWord    getUint16
 #define getOffset16  getUint16
@@ -9,6 +21,14 @@
 
 namespace Truetype
 {
+	// Unaligned big endian loads. These assume a little endian host, which is every platform we build for.
+	// They do not check bounds, so only use them on spans that have already been checked.
+	inline uint16 loadUint16(const uint8* p) { uint16 v; memcpy(&v, p, sizeof(v)); return TTF_BSWAP16(v); }
+	inline int16 loadInt16(const uint8* p) { return (int16)loadUint16(p); }
+	inline uint32 loadUint32(const uint8* p) { uint32 v; memcpy(&v, p, sizeof(v)); return TTF_BSWAP32(v); }
+	inline int32 loadInt32(const uint8* p) { return (int32)loadUint32(p); }
+	inline uint64 loadUint64(const uint8* p) { uint64 v; memcpy(&v, p, sizeof(v)); return TTF_BSWAP64(v); }
+
 	bool tagEquals(uint8* p, char c0, char c1, char c2, char c3);
 	bool tagEquals(uint8* p, const char* str);
 
@@ -17,6 +37,10 @@ namespace Truetype
 	uint32 toULong(uint8* pointer);
 	int32 toLong(uint8* pointer);
 
+	// True if numBytes can be read from the cursor. Check a whole span once, then read it with the load functions.
+	inline bool canRead(const Buffer& buffer, int numBytes) { return numBytes >= 0 && buffer.cursor <= buffer.size - numBytes; }
+	inline const uint8* cursorPtr(const Buffer& buffer) { return (const uint8*)buffer.data + buffer.cursor; }
+
 	uint8 peekUint8(Buffer& buffer);
 	void seek(Buffer& buffer, int offset);
 	void skip(Buffer& buffer, int numBytes);
@@ -30,6 +54,10 @@ namespace Truetype
 	int16 getInt16(Buffer& buffer); 
 	int32 getInt32(Buffer& buffer);
 
+	// Read count big endian values into a native array. Values past the end of the buffer read as 0.
+	void getUint16Array(Buffer& buffer, uint16* values, int count);
+	void getInt16Array(Buffer& buffer, int16* values, int count);
+
 	Tag getTag(Buffer& buffer);
 
 	LongDateTime getDateTime(Buffer& buffer);
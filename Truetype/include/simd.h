@@ -0,0 +1,66 @@
+#pragma once
+#include "dataStructures.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TTF_X86 1
+#else
+#define TTF_X86 0
+#endif
+
+// Functions using instructions above the compiler's baseline have to be marked on GCC/Clang.
+// MSVC lets you use any intrinsic anywhere, so these expand to nothing there.
+#if TTF_X86 && (defined(__GNUC__) || defined(__clang__))
+#define TTF_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TTF_TARGET_AVX2  __attribute__((target("avx2")))
+#else
+#define TTF_TARGET_SSSE3
+#define TTF_TARGET_AVX2
+#endif
+
+namespace Truetype
+{
+	// Runtime CPU feature detection. The result is computed once and cached.
+	bool cpuHasSsse3();
+	bool cpuHasAvx2();
+
+	// Forces the scalar paths when false, for testing and benchmarking them against the SIMD ones
+	void setSimdEnabled(bool enabled);
+
+	// Converts count big endian uint32 values at src to native uint32 values
+	void decodeBigEndianUint32s(const uint8* src, uint32* dst, size_t count);
+
+	// Converts count big endian uint16 values at src to native uint32 values, each multiplied by scale
+	void decodeBigEndianUint16sToUint32s(const uint8* src, uint32* dst, size_t count, uint32 scale);
+
+	// Reads the delta of one point's coordinate and advances coords past it. This is the scalar decode that
+	// decodeGlyphCoordinates and the segment iterator share.
+	inline int16 readGlyphCoordinateDelta(uint8 flag, const uint8*& coords, uint8 shortFlag, uint8 sameFlag)
+	{
+		if (flag & shortFlag)
+		{
+			int16 delta = (flag & sameFlag) ? *coords : -*coords;
+			coords++;
+			return delta;
+		}
+		if (~flag & sameFlag)
+		{
+			int16 delta = (int16)(((uint16)coords[0] << 8) | coords[1]);
+			coords += 2;
+			return delta;
+		}
+		return 0;
+	}
+
+	// Decodes one coordinate array of a simple glyph. shortFlag and sameFlag pick the x (0x02, 0x10) or y (0x04, 0x20)
+	// bits out of the expanded flags, and the deltas are summed into absolute coordinates.
+	// The caller has already checked that all the coordinate bytes can be read. The SIMD path loads up to 16 bytes at
+	// a time, so readEnd is where readable memory ends, not where the coordinates end.
+	// Returns a pointer just past the last coordinate byte.
+	const uint8* decodeGlyphCoordinates(const uint8* flags, int numPoints, const uint8* coords, const uint8* readEnd,
+		int16* dst, uint8 shortFlag, uint8 sameFlag);
+
+	// Turns one row of signed area cells into 8-bit coverage. The running sum of cells[0..i] is the coverage of pixel
+	// i, and its absolute value is clamped to 1 and scaled to 255. The SIMD paths sum in a different order, so they
+	// can round a pixel one step away from the scalar one.
+	void accumulateCoverage(const float* cells, uint8* coverage, int count);
+}
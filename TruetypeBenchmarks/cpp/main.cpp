@@ -0,0 +1,812 @@
+#include <chrono>
+#include <thread>
+
+#include "glyph.h"
+#include "simd.h"
+#include "glyphCache.h"
+#include "outline.h"
+#include "metrics.h"
+#include "raster.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_write.h"
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "stb_truetype.h"
+
+static const char* fontNames[] = {
+	"C:/Windows/Fonts/Arial.ttf",
+	"C:/Windows/Fonts/BKANT.TTF",
+	"C:/Windows/Fonts/msgothic.ttc",
+	"C:/Windows/Fonts/simsun.ttc",
+	"C:/Windows/Fonts/seguiemj.ttf"
+};
+static const int numFonts = sizeof(fontNames) / sizeof(fontNames[0]);
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double elapsedMicroseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// Simulates service startup: load the font and look up the glyphs for the printable ASCII range
+static double benchmarkLoadFont(const char* fontName, Truetype::FontLoadMode mode, int iterations)
+{
+	uint32_t checksum = 0;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontName, mode))
+		{
+			return 0.0;
+		}
+
+		for (uint16_t c = ' '; c <= '~'; c++)
+		{
+			checksum += Truetype::getGlyph(c, fontInfo).numberOfContours;
+		}
+		Truetype::freeFont(fontInfo);
+	}
+	double result = elapsedMicroseconds(start) / iterations;
+	if (checksum == 0xFFFFFFFF) printf(" ");
+	return result;
+}
+
+static void benchmarkStartup()
+{
+	printf("Font startup (load + ASCII glyph lookup), average per load:\n");
+	const int iterations = 50;
+	for (int i = 0; i < numFonts; i++)
+	{
+		double copyTime = benchmarkLoadFont(fontNames[i], Truetype::FontLoadMode::Copy, iterations);
+		double mapTime = benchmarkLoadFont(fontNames[i], Truetype::FontLoadMode::MemoryMap, iterations);
+		if (copyTime == 0.0 || mapTime == 0.0)
+		{
+			continue;
+		}
+
+		printf("  %-40s copy: %10.2f us   mmap: %10.2f us   (%.2fx)\n", fontNames[i], copyTime, mapTime, copyTime / mapTime);
+	}
+	printf("\n");
+}
+
+// Looks up every codepoint in the basic multilingual plane, returns the average nanoseconds per lookup
+template<typename LookupFn>
+static double benchmarkBmpLookup(LookupFn lookup, int iterations)
+{
+	uint32_t checksum = 0;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		for (uint32_t c = 0; c <= 0xFFFF; c++)
+		{
+			checksum += lookup(c);
+		}
+	}
+	double result = elapsedMicroseconds(start) * 1000.0 / (iterations * 0x10000);
+	if (checksum == 0xFFFFFFFF) printf(" ");
+	return result;
+}
+
+static void benchmarkGlyphIdLookup()
+{
+	printf("Codepoint to glyph id, every BMP codepoint, average per lookup:\n");
+	const int iterations = 20;
+	for (int i = 0; i < numFonts; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[i]))
+		{
+			printf("  Skipping %s, it could not be loaded\n", fontNames[i]);
+			continue;
+		}
+
+		stbtt_fontinfo stbFont;
+		stbtt_InitFont(&stbFont, (unsigned char*)fontInfo.data, stbtt_GetFontOffsetForIndex((unsigned char*)fontInfo.data, 0));
+
+		Truetype::FontInfo pageTableFontInfo;
+		Truetype::loadFont(pageTableFontInfo, fontNames[i], Truetype::FontLoadMode::MemoryMap, Truetype::INIT_GLYPH_PAGE_TABLE);
+
+		double myTime = benchmarkBmpLookup([&](uint32_t c) { return Truetype::getGlyphId(c, fontInfo); }, iterations);
+		double pageTableTime = benchmarkBmpLookup([&](uint32_t c) { return Truetype::getGlyphId(c, pageTableFontInfo); }, iterations);
+		double stbTime = benchmarkBmpLookup([&](uint32_t c) { return (uint32_t)stbtt_FindGlyphIndex(&stbFont, (int)c); }, iterations);
+		printf("  %-40s getGlyphId: %6.2f ns   page table: %6.2f ns   stbtt_FindGlyphIndex: %6.2f ns   (cmap format %d)\n",
+			fontNames[i], myTime, pageTableTime, stbTime, fontInfo.cmapFormat);
+		printf("  %-40s memory: %u bytes   with page table: %u bytes\n", "",
+			(unsigned int)Truetype::getFontMemoryUsage(fontInfo), (unsigned int)Truetype::getFontMemoryUsage(pageTableFontInfo));
+
+		Truetype::freeFont(pageTableFontInfo);
+		Truetype::freeFont(fontInfo);
+	}
+	printf("\n");
+}
+
+static const char32_t* latinText = U"The quick brown fox jumps over the lazy dog. Pack my box with five dozen liquor jugs! "
+	U"Zwölf Boxkämpfer jagen Viktor quer über den großen Sylter Deich. Voix ambiguë d'un cœur qui, au zéphyr, préfère les jattes de kiwis.";
+static const char32_t* cyrillicText = U"Съешь же ещё этих мягких французских булок, да выпей чаю. "
+	U"В чащах юга жил бы цитрус? Да, но фальшивый экземпляр! Широкая электрификация южных губерний даст мощный толчок подъёму сельского хозяйства.";
+static const char32_t* cjkText = U"天地玄黄宇宙洪荒日月盈昃辰宿列张寒来暑往秋收冬藏闰余成岁律吕调阳云腾致雨露结为霜金生丽水玉出昆冈"
+	U"いろはにほへとちりぬるをわかよたれそつねならむうゐのおくやまけふこえてあさきゆめみしゑひもせす"
+	U"키스의 고유조건은 입술끼리 만나야 하고 특별한 기술은 필요치 않다";
+
+static void fillCorpus(Truetype::uint32* codepoints, int numCodepoints, const char32_t* text)
+{
+	int textLength = 0;
+	while (text[textLength]) textLength++;
+	for (int i = 0; i < numCodepoints; i++)
+	{
+		codepoints[i] = (Truetype::uint32)text[i % textLength];
+	}
+}
+
+static void benchmarkGlyphIdsForFont(const Truetype::FontInfo& fontInfo, const char* label)
+{
+	const int numCodepoints = 1 << 16;
+	const int iterations = 50;
+	const char32_t* corpora[] = { latinText, cyrillicText, cjkText };
+	const char* corpusNames[] = { "Latin", "Cyrillic", "CJK" };
+
+	Truetype::uint32* codepoints = (Truetype::uint32*)malloc(sizeof(Truetype::uint32) * numCodepoints);
+	Truetype::uint16* glyphIds = (Truetype::uint16*)malloc(sizeof(Truetype::uint16) * numCodepoints);
+	for (int corpus = 0; corpus < 3; corpus++)
+	{
+		fillCorpus(codepoints, numCodepoints, corpora[corpus]);
+
+		uint32_t checksum = 0;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			for (int c = 0; c < numCodepoints; c++)
+			{
+				glyphIds[c] = (Truetype::uint16)Truetype::getGlyphId(codepoints[c], fontInfo);
+			}
+			checksum += glyphIds[i];
+		}
+		double singleSeconds = elapsedMicroseconds(start) / 1000000.0;
+
+		start = Clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			Truetype::getGlyphIds(codepoints, numCodepoints, glyphIds, fontInfo);
+			checksum += glyphIds[i];
+		}
+		double batchSeconds = elapsedMicroseconds(start) / 1000000.0;
+
+		double totalCodepoints = (double)numCodepoints * iterations;
+		printf("  %-12s %-9s getGlyphId: %8.1f M codepoints/s   getGlyphIds: %8.1f M codepoints/s\n",
+			label, corpusNames[corpus], totalCodepoints / singleSeconds / 1000000.0, totalCodepoints / batchSeconds / 1000000.0);
+		if (checksum == 0xFFFFFFFF) printf(" ");
+	}
+	free(codepoints);
+	free(glyphIds);
+}
+
+static void benchmarkGlyphIdsBatch()
+{
+	printf("Batched codepoint to glyph id throughput:\n");
+	for (int i = 0; i < numFonts; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[i]))
+		{
+			printf("  Skipping %s, it could not be loaded\n", fontNames[i]);
+			continue;
+		}
+		Truetype::FontInfo pageTableFontInfo;
+		Truetype::loadFont(pageTableFontInfo, fontNames[i], Truetype::FontLoadMode::MemoryMap, Truetype::INIT_GLYPH_PAGE_TABLE);
+
+		printf("  %s\n", fontNames[i]);
+		benchmarkGlyphIdsForFont(fontInfo, "cmap");
+		benchmarkGlyphIdsForFont(pageTableFontInfo, "page table");
+
+		Truetype::freeFont(pageTableFontInfo);
+		Truetype::freeFont(fontInfo);
+	}
+	printf("\n");
+}
+
+// Kerning for every adjacent pair of a run of English text
+static void benchmarkKerning()
+{
+	printf("Kerning lookups per pair (GPOS when the font has it, else the kern table):\n");
+	const char* text = "AVAST WAYWARD TRAVELLER, To You Yonder Fjord Looks Very Wavy. The quick brown fox jumps over the lazy dog. ";
+	const int runLength = 16 * 1024;
+	const int iterations = 100;
+	static uint32_t codepoints[runLength];
+	static uint16_t glyphIds[runLength];
+	static int16_t kerning[runLength];
+	size_t textLength = strlen(text);
+	for (int i = 0; i < runLength; i++)
+	{
+		codepoints[i] = (uint8_t)text[i % textLength];
+	}
+
+	for (int i = 0; i < numFonts; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[i]))
+		{
+			printf("  Skipping %s, it could not be loaded\n", fontNames[i]);
+			continue;
+		}
+		Truetype::getGlyphIds(codepoints, runLength, glyphIds, fontInfo);
+		stbtt_fontinfo stbttFont;
+		stbtt_InitFont(&stbttFont, (unsigned char*)fontInfo.data, stbtt_GetFontOffsetForIndex((unsigned char*)fontInfo.data, 0));
+
+		int64_t checksum = 0;
+		Clock::time_point start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int c = 0; c + 1 < runLength; c++)
+			{
+				checksum += Truetype::getKerning(glyphIds[c], glyphIds[c + 1], fontInfo);
+			}
+		}
+		double singleTime = elapsedMicroseconds(start);
+
+		start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			Truetype::getKerning(glyphIds, runLength, kerning, fontInfo);
+			checksum += kerning[iteration];
+		}
+		double batchTime = elapsedMicroseconds(start);
+
+		start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int c = 0; c + 1 < runLength; c++)
+			{
+				checksum += Truetype::getKernTableKerning(glyphIds[c], glyphIds[c + 1], fontInfo);
+			}
+		}
+		double kernTime = elapsedMicroseconds(start);
+
+		start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int c = 0; c + 1 < runLength; c++)
+			{
+				checksum += stbtt__GetGlyphKernInfoAdvance(&stbttFont, glyphIds[c], glyphIds[c + 1]);
+			}
+		}
+		double stbKernTime = elapsedMicroseconds(start);
+
+		start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int c = 0; c + 1 < runLength; c++)
+			{
+				checksum += stbttFont.gpos ? stbtt__GetGlyphGPOSInfoAdvance(&stbttFont, glyphIds[c], glyphIds[c + 1]) : 0;
+			}
+		}
+		double stbGposTime = elapsedMicroseconds(start);
+
+		double numPairs = (double)iterations * (runLength - 1);
+		printf("  %-40s ns per pair: single %6.2f   batch %6.2f   kern table %6.2f   stb kern %6.2f   stb GPOS %6.2f\n", fontNames[i],
+			singleTime * 1000.0 / numPairs, batchTime * 1000.0 / numPairs, kernTime * 1000.0 / numPairs,
+			stbKernTime * 1000.0 / numPairs, stbGposTime * 1000.0 / numPairs);
+		if (checksum == 0x7FFFFFFF) printf(" ");
+
+		Truetype::freeFont(fontInfo);
+	}
+	printf("\n");
+}
+
+static void benchmarkGlyphDecode()
+{
+	printf("getGlyphData over every glyph in the font:\n");
+	const int iterations = 20;
+	for (int i = 0; i < numFonts; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[i]))
+		{
+			printf("  Skipping %s, it could not be loaded\n", fontNames[i]);
+			continue;
+		}
+
+		uint32_t checksum = 0;
+		int numDecoded = 0;
+		Clock::time_point start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int glyphId = 0; glyphId < fontInfo.numGlyphs; glyphId++)
+			{
+				Truetype::Glyph glyph = Truetype::getGlyphById(glyphId, fontInfo);
+				if (glyph.numberOfContours <= 0)
+				{
+					continue;
+				}
+
+				Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, fontInfo);
+				checksum += glyphData.numPoints;
+				Truetype::freeGlyphData(glyphData);
+				numDecoded++;
+			}
+		}
+		double mallocTime = elapsedMicroseconds(start);
+
+		Truetype::GlyphScratch scratch = Truetype::createGlyphScratch(fontInfo);
+		start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int glyphId = 0; glyphId < fontInfo.numGlyphs; glyphId++)
+			{
+				Truetype::Glyph glyph = Truetype::getGlyphById(glyphId, fontInfo);
+				if (glyph.numberOfContours <= 0)
+				{
+					continue;
+				}
+
+				Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, fontInfo, scratch);
+				checksum += glyphData.numPoints;
+			}
+		}
+		double scratchTime = elapsedMicroseconds(start);
+		Truetype::freeGlyphScratch(scratch);
+
+		// Keep every glyph of the font, then release them all at once
+		Truetype::Arena arena = Truetype::createArena();
+		start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int glyphId = 0; glyphId < fontInfo.numGlyphs; glyphId++)
+			{
+				Truetype::Glyph glyph = Truetype::getGlyphById(glyphId, fontInfo);
+				if (glyph.numberOfContours <= 0)
+				{
+					continue;
+				}
+
+				Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, fontInfo, arena);
+				checksum += glyphData.numPoints;
+			}
+			Truetype::resetArena(arena);
+		}
+		double arenaTime = elapsedMicroseconds(start);
+		Truetype::freeArena(arena);
+
+		int perGlyph = numDecoded > 0 ? numDecoded : 1;
+		printf("  %-40s ns per glyph: malloc %8.1f   scratch %8.1f   arena %8.1f\n",
+			fontNames[i], mallocTime * 1000.0 / perGlyph, scratchTime * 1000.0 / perGlyph, arenaTime * 1000.0 / perGlyph);
+		if (checksum == 0xFFFFFFFF) printf(" ");
+
+		Truetype::freeFont(fontInfo);
+	}
+	printf("\n");
+}
+
+// A consumer that looks at every segment once, like a rasterizer building its edge list
+static int32_t accumulateSegment(const Truetype::Segment& segment)
+{
+	return segment.x0 * segment.y1 - segment.x1 * segment.y0;
+}
+
+static void benchmarkSegmentIterator()
+{
+	printf("One pass over every glyph's segments:\n");
+	const int iterations = 20;
+	for (int i = 0; i < numFonts; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[i]))
+		{
+			printf("  Skipping %s, it could not be loaded\n", fontNames[i]);
+			continue;
+		}
+
+		int32_t checksum = 0;
+		int numGlyphs = 0;
+		Clock::time_point start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int glyphId = 0; glyphId < fontInfo.numGlyphs; glyphId++)
+			{
+				Truetype::Glyph glyph = Truetype::getGlyphById(glyphId, fontInfo);
+				Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, fontInfo);
+				Truetype::GlyphSegments segments = Truetype::getGlyphSegments(glyphData);
+				for (int s = 0; s < segments.numSegments; s++)
+				{
+					checksum += accumulateSegment(segments.segments[s]);
+				}
+				Truetype::freeGlyphSegments(segments);
+				Truetype::freeGlyphData(glyphData);
+				numGlyphs++;
+			}
+		}
+		double decodeTime = elapsedMicroseconds(start);
+
+		Truetype::GlyphScratch scratch = Truetype::createGlyphScratch(fontInfo);
+		Truetype::Arena arena = Truetype::createArena();
+		start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int glyphId = 0; glyphId < fontInfo.numGlyphs; glyphId++)
+			{
+				Truetype::Glyph glyph = Truetype::getGlyphById(glyphId, fontInfo);
+				Truetype::GlyphSegments segments = Truetype::getGlyphSegments(glyph, fontInfo, scratch, arena);
+				for (int s = 0; s < segments.numSegments; s++)
+				{
+					checksum += accumulateSegment(segments.segments[s]);
+				}
+				Truetype::resetArena(arena);
+			}
+		}
+		double scratchTime = elapsedMicroseconds(start);
+		Truetype::freeArena(arena);
+		Truetype::freeGlyphScratch(scratch);
+
+		start = Clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int glyphId = 0; glyphId < fontInfo.numGlyphs; glyphId++)
+			{
+				Truetype::Glyph glyph = Truetype::getGlyphById(glyphId, fontInfo);
+				Truetype::SegmentIterator iterator;
+				Truetype::beginGlyphSegments(iterator, glyph, fontInfo);
+				Truetype::Segment segment;
+				while (Truetype::nextGlyphSegment(iterator, segment))
+				{
+					checksum += accumulateSegment(segment);
+				}
+			}
+		}
+		double iteratorTime = elapsedMicroseconds(start);
+
+		int perGlyph = numGlyphs > 0 ? numGlyphs : 1;
+		printf("  %-40s ns per glyph: decode+free %8.1f   scratch+arena %8.1f   iterator %8.1f\n",
+			fontNames[i], decodeTime * 1000.0 / perGlyph, scratchTime * 1000.0 / perGlyph, iteratorTime * 1000.0 / perGlyph);
+		if (checksum == 0x7FFFFFFF) printf(" ");
+
+		Truetype::freeFont(fontInfo);
+	}
+	printf("\n");
+}
+
+static double timeGlyphDecode(Truetype::FontInfo& fontInfo, Truetype::GlyphScratch& scratch, const Truetype::uint32* glyphIds, int numGlyphIds, int iterations, uint32_t& checksum)
+{
+	Clock::time_point start = Clock::now();
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		for (int i = 0; i < numGlyphIds; i++)
+		{
+			Truetype::Glyph glyph = Truetype::getGlyphById(glyphIds[i], fontInfo);
+			Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, fontInfo, scratch);
+			checksum += glyphData.xCoords[glyphData.numPoints - 1];
+		}
+	}
+	return elapsedMicroseconds(start);
+}
+
+static void benchmarkGlyphDecodeSimd()
+{
+	printf("getGlyphData coordinate decoding, SIMD against scalar:\n");
+	const int iterations = 50;
+	for (int i = 0; i < numFonts; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[i]))
+		{
+			printf("  Skipping %s, it could not be loaded\n", fontNames[i]);
+			continue;
+		}
+
+		// Every glyph the scratch decodes, and the large ones like CJK ideographs separately
+		Truetype::GlyphScratch scratch = Truetype::createGlyphScratch(fontInfo);
+		Truetype::uint32* allGlyphs = (Truetype::uint32*)malloc(sizeof(Truetype::uint32) * fontInfo.numGlyphs);
+		Truetype::uint32* largeGlyphs = (Truetype::uint32*)malloc(sizeof(Truetype::uint32) * fontInfo.numGlyphs);
+		int numAll = 0;
+		int numLarge = 0;
+		for (int glyphId = 0; glyphId < fontInfo.numGlyphs; glyphId++)
+		{
+			Truetype::Glyph glyph = Truetype::getGlyphById(glyphId, fontInfo);
+			Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, fontInfo, scratch);
+			if (glyphData.numPoints > 0)
+			{
+				allGlyphs[numAll++] = glyphId;
+			}
+			if (glyphData.numPoints >= 200)
+			{
+				largeGlyphs[numLarge++] = glyphId;
+			}
+		}
+
+		uint32_t checksum = 0;
+		double simdAll = timeGlyphDecode(fontInfo, scratch, allGlyphs, numAll, iterations, checksum);
+		double simdLarge = timeGlyphDecode(fontInfo, scratch, largeGlyphs, numLarge, iterations, checksum);
+		Truetype::setSimdEnabled(false);
+		double scalarAll = timeGlyphDecode(fontInfo, scratch, allGlyphs, numAll, iterations, checksum);
+		double scalarLarge = timeGlyphDecode(fontInfo, scratch, largeGlyphs, numLarge, iterations, checksum);
+		Truetype::setSimdEnabled(true);
+		Truetype::freeGlyphScratch(scratch);
+
+		int perAll = numAll * iterations > 0 ? numAll * iterations : 1;
+		int perLarge = numLarge * iterations > 0 ? numLarge * iterations : 1;
+		printf("  %-40s all: %7.1f vs %7.1f ns per glyph   200+ points (%d): %7.1f vs %7.1f ns per glyph\n",
+			fontNames[i], simdAll * 1000.0 / perAll, scalarAll * 1000.0 / perAll,
+			numLarge, simdLarge * 1000.0 / perLarge, scalarLarge * 1000.0 / perLarge);
+		if (checksum == 0xFFFFFFFF) printf(" ");
+
+		free(allGlyphs);
+		free(largeGlyphs);
+		Truetype::freeFont(fontInfo);
+	}
+	printf("\n");
+}
+
+// Every thread decodes every glyph of the font, with or without a shared cache
+static double timeThreadedDecode(Truetype::FontInfo& fontInfo, Truetype::GlyphCache* cache, int numThreads, int iterations)
+{
+	std::thread threads[64];
+	Clock::time_point start = Clock::now();
+	for (int t = 0; t < numThreads; t++)
+	{
+		threads[t] = std::thread([&fontInfo, cache, iterations]()
+		{
+			Truetype::GlyphScratch scratch = Truetype::createGlyphScratch(fontInfo);
+			uint32_t checksum = 0;
+			for (int iteration = 0; iteration < iterations; iteration++)
+			{
+				for (int glyphId = 0; glyphId < fontInfo.numGlyphs; glyphId++)
+				{
+					Truetype::Glyph glyph = Truetype::getGlyphById(glyphId, fontInfo);
+					Truetype::GlyphData glyphData = cache ?
+						Truetype::getGlyphData(*cache, glyph, fontInfo, scratch) :
+						Truetype::getGlyphData(glyph, fontInfo, scratch);
+					checksum += glyphData.numPoints;
+				}
+			}
+			Truetype::freeGlyphScratch(scratch);
+			if (checksum == 0xFFFFFFFF) printf(" ");
+		});
+	}
+	for (int t = 0; t < numThreads; t++)
+	{
+		threads[t].join();
+	}
+	return elapsedMicroseconds(start);
+}
+
+static void benchmarkGlyphRaster()
+{
+	printf("Hard edged rasterization of 'Hamburgefonstiv', segments decoded up front:\n");
+	const char* text = "Hamburgefonstiv";
+	const int pixelSizes[] = { 16, 64, 512 };
+	const int iterations[] = { 50, 5, 1 };
+	const int maxGlyphs = 16;
+	for (int i = 0; i < numFonts; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[i]))
+		{
+			printf("  Skipping %s, it could not be loaded\n", fontNames[i]);
+			continue;
+		}
+
+		Truetype::Glyph glyphs[maxGlyphs];
+		Truetype::GlyphData glyphData[maxGlyphs];
+		Truetype::GlyphSegments segments[maxGlyphs];
+		int numGlyphs = 0;
+		for (const char* c = text; *c && numGlyphs < maxGlyphs; c++)
+		{
+			glyphs[numGlyphs] = Truetype::getGlyph((uint8_t)*c, fontInfo);
+			glyphData[numGlyphs] = Truetype::getGlyphData(glyphs[numGlyphs], fontInfo);
+			segments[numGlyphs] = Truetype::getGlyphSegments(glyphData[numGlyphs]);
+			numGlyphs++;
+		}
+
+		// Outlines prepared once and reused for every size
+		Truetype::Arena outlineArena = Truetype::createArena();
+		Truetype::PreparedOutline outlines[maxGlyphs];
+		for (int g = 0; g < numGlyphs; g++)
+		{
+			outlines[g] = Truetype::prepareGlyphOutline(segments[g], 1.0f, outlineArena);
+		}
+
+		printf("  %s\n", fontNames[i]);
+		Truetype::Arena arena = Truetype::createArena();
+		for (int size = 0; size < 3; size++)
+		{
+			double times[3] = { 0.0, 0.0, 0.0 };
+			int32_t checksum = 0;
+			for (int method = 0; method < 3; method++)
+			{
+				Clock::time_point start = Clock::now();
+				for (int iteration = 0; iteration < iterations[size]; iteration++)
+				{
+					for (int g = 0; g < numGlyphs; g++)
+					{
+						const Truetype::Glyph& glyph = glyphs[g];
+						int width = (glyph.xMax - glyph.xMin) * pixelSizes[size] / fontInfo.unitsPerEm + 1;
+						int height = (glyph.yMax - glyph.yMin) * pixelSizes[size] / fontInfo.unitsPerEm + 1;
+						uint8_t* pixels = (uint8_t*)Truetype::arenaAllocate(arena, width * height, 1);
+						if (method == 0)
+						{
+							Truetype::rasterizeGlyphWinding(segments[g], glyph, width, height, pixels, arena);
+						}
+						else if (method == 1)
+						{
+							Truetype::rasterizeGlyphScanline(segments[g], glyph, width, height, pixels, arena);
+						}
+						else
+						{
+							Truetype::rasterizeGlyphScanline(outlines[g], glyph, width, height, pixels, arena);
+						}
+						checksum += pixels[width * height / 2];
+						Truetype::resetArena(arena);
+					}
+				}
+				times[method] = elapsedMicroseconds(start) / ((double)iterations[size] * numGlyphs);
+			}
+			printf("    %3d px   us per glyph: winding %10.2f   scanline %8.2f   (%.0fx)   prepared scanline %8.2f\n", pixelSizes[size],
+				times[0], times[1], times[0] / times[1], times[2]);
+			if (checksum == 0x7FFFFFFF) printf(" ");
+		}
+		Truetype::freeArena(arena);
+		Truetype::freeArena(outlineArena);
+
+		for (int g = 0; g < numGlyphs; g++)
+		{
+			Truetype::freeGlyphSegments(segments[g]);
+			Truetype::freeGlyphData(glyphData[g]);
+		}
+		Truetype::freeFont(fontInfo);
+	}
+	printf("\n");
+}
+
+static void benchmarkGlyphCoverage()
+{
+	printf("Anti-aliased rasterization of 'Hamburgefonstiv', from the glyph id to 8-bit coverage:\n");
+	const char* text = "Hamburgefonstiv";
+	const float pixelSizes[] = { 16.0f, 64.0f, 512.0f };
+	const int iterations[] = { 200, 50, 2 };
+	for (int i = 0; i < numFonts; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[i]))
+		{
+			printf("  Skipping %s, it could not be loaded\n", fontNames[i]);
+			continue;
+		}
+		stbtt_fontinfo stbttFont;
+		stbtt_InitFont(&stbttFont, (unsigned char*)fontInfo.data, stbtt_GetFontOffsetForIndex((unsigned char*)fontInfo.data, 0));
+
+		size_t textLength = strlen(text);
+		printf("  %s\n", fontNames[i]);
+		Truetype::GlyphScratch scratch = Truetype::createGlyphScratch(fontInfo);
+		Truetype::Arena arena = Truetype::createArena();
+		uint8_t* pixels = (uint8_t*)malloc(1024 * 1024);
+		for (int size = 0; size < 3; size++)
+		{
+			float scale = pixelSizes[size] / fontInfo.unitsPerEm;
+			int32_t checksum = 0;
+			Clock::time_point start = Clock::now();
+			for (int iteration = 0; iteration < iterations[size]; iteration++)
+			{
+				for (size_t c = 0; c < textLength; c++)
+				{
+					Truetype::Glyph glyph = Truetype::getGlyph((uint8_t)text[c], fontInfo);
+					int x0 = (int)floorf(glyph.xMin * scale);
+					int y0 = (int)floorf(glyph.yMin * scale);
+					int width = (int)ceilf(glyph.xMax * scale) - x0;
+					int height = (int)ceilf(glyph.yMax * scale) - y0;
+					Truetype::GlyphSegments segments = Truetype::getGlyphSegments(glyph, fontInfo, scratch, arena);
+					Truetype::GlyphPolyline polyline = Truetype::flattenGlyphSegments(segments, scale, 0.25f, arena);
+					Truetype::rasterizeGlyphCoverage(polyline, (float)-x0, (float)-y0, width, height, pixels, arena);
+					checksum += pixels[width * height / 2];
+					Truetype::resetArena(arena);
+				}
+			}
+			double coverageTime = elapsedMicroseconds(start);
+
+			start = Clock::now();
+			for (int iteration = 0; iteration < iterations[size]; iteration++)
+			{
+				for (size_t c = 0; c < textLength; c++)
+				{
+					int glyphIndex = stbtt_FindGlyphIndex(&stbttFont, (uint8_t)text[c]);
+					int x0, y0, x1, y1;
+					stbtt_GetGlyphBitmapBox(&stbttFont, glyphIndex, scale, scale, &x0, &y0, &x1, &y1);
+					stbtt_MakeGlyphBitmap(&stbttFont, pixels, x1 - x0, y1 - y0, x1 - x0, scale, scale, glyphIndex);
+					checksum += pixels[(x1 - x0) * (y1 - y0) / 2];
+				}
+			}
+			double stbTime = elapsedMicroseconds(start);
+
+			double numGlyphs = (double)iterations[size] * textLength;
+			printf("    %3.0f px   us per glyph: coverage %8.2f   stb %8.2f   (%.1fx)\n", pixelSizes[size], coverageTime / numGlyphs,
+				stbTime / numGlyphs, stbTime / coverageTime);
+			if (checksum == 0x7FFFFFFF) printf(" ");
+		}
+		free(pixels);
+		Truetype::freeArena(arena);
+		Truetype::freeGlyphScratch(scratch);
+		Truetype::freeFont(fontInfo);
+	}
+	printf("\n");
+}
+
+static void benchmarkGlyphCache()
+{
+	printf("Glyph outline cache against decoding every time, all glyphs per thread:\n");
+	const int iterations = 20;
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	maxThreads = maxThreads < 1 ? 1 : (maxThreads > 64 ? 64 : maxThreads);
+	for (int i = 0; i < numFonts; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[i]))
+		{
+			printf("  Skipping %s, it could not be loaded\n", fontNames[i]);
+			continue;
+		}
+
+		for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+		{
+			Truetype::GlyphCache* cache = Truetype::createGlyphCache(64 * 1024 * 1024);
+			double decodeTime = timeThreadedDecode(fontInfo, nullptr, numThreads, iterations);
+			double cacheTime = timeThreadedDecode(fontInfo, cache, numThreads, iterations);
+			Truetype::GlyphCacheStats stats = Truetype::getGlyphCacheStats(*cache);
+			Truetype::freeGlyphCache(cache);
+
+			double numDecoded = (double)fontInfo.numGlyphs * iterations * numThreads;
+			printf("  %-40s %2d threads: decode %8.1f ns per glyph   cached %8.1f ns per glyph   (%llu hits, %llu misses)\n",
+				fontNames[i], numThreads, decodeTime * 1000.0 / numDecoded, cacheTime * 1000.0 / numDecoded,
+				(unsigned long long)stats.hits, (unsigned long long)stats.misses);
+		}
+
+		Truetype::freeFont(fontInfo);
+	}
+	printf("\n");
+}
+
+static void benchmarkWriteInternalFont()
+{
+	printf("writeInternalFont scaling with threads:\n");
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	maxThreads = maxThreads < 1 ? 1 : maxThreads;
+	for (int i = 0; i < numFonts; i++)
+	{
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[i]))
+		{
+			printf("  Skipping %s, it could not be loaded\n", fontNames[i]);
+			continue;
+		}
+
+		double serialTime = 0.0;
+		for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+		{
+			Clock::time_point start = Clock::now();
+			Truetype::writeInternalFont(fontInfo, "benchmarkFont.bin", numThreads);
+			double totalTime = elapsedMicroseconds(start);
+			serialTime = numThreads == 1 ? totalTime : serialTime;
+			printf("  %-40s %2d threads: %10.2f ms   %5.2fx\n", fontNames[i], numThreads, totalTime / 1000.0, serialTime / totalTime);
+		}
+		remove("benchmarkFont.bin");
+
+		Truetype::freeFont(fontInfo);
+	}
+	printf("\n");
+}
+
+int main()
+{
+	benchmarkStartup();
+	benchmarkGlyphIdLookup();
+	benchmarkGlyphIdsBatch();
+	benchmarkKerning();
+	benchmarkGlyphDecode();
+	benchmarkGlyphDecodeSimd();
+	benchmarkSegmentIterator();
+	benchmarkGlyphRaster();
+	benchmarkGlyphCoverage();
+	benchmarkGlyphCache();
+	benchmarkWriteInternalFont();
+
+	return 0;
+}
@@ -71,38 +71,24 @@ static void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 
 static void uploadFontAsTexture(const char* fontFile)
 {
-	FILE* file = fopen(fontFile, "rb");
-	if (!file)
+	Truetype::MappedFile file = Truetype::mapFile(fontFile);
+	if (!file.data)
 	{
-		printf("Error could not open file %s", fontFile);
 		return;
 	}
 
-	fseek(file, 0, SEEK_END);
-	size_t size = ftell(file);
-	rewind(file);
-
-	char* data = (char*)malloc(sizeof(char) * size);
-	if (!data)
-	{
-		printf("Error could not allocate enough memory");
-		return;
-	}
-	// TODO: error check this, and read more if needed
-	size_t readAmt = fread(data, 1, size, file);
-
 	glGenBuffers(1, &fontBuffer);
 	glBindBuffer(GL_TEXTURE_BUFFER, fontBuffer);
-	glBufferData(GL_TEXTURE_BUFFER, sizeof(char) * readAmt, (void*)data, GL_STATIC_READ);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(char) * file.size, (void*)file.data, GL_STATIC_READ);
 
 	glGenTextures(1, &fontTextureHandle);
 	glBindTexture(GL_TEXTURE_BUFFER, fontTextureHandle);
 
 	glTexBuffer(GL_TEXTURE_BUFFER, GL_R16UI, fontBuffer);
 
-	printf("Texture Buffer Size: %u KB\n", (readAmt) / 1024);
+	printf("Texture Buffer Size: %u KB\n", (unsigned int)(file.size / 1024));
 
-	free(data);
+	Truetype::unmapFile(file);
 }
 
 static void initVertexAttributes()
@@ -298,28 +284,12 @@ void runGlWindow()
 int main()
 {
 	const char* font = "C:\\Windows\\Fonts\\arial.ttf";
-	FILE* file = fopen(font, "rb");
-	if (!file)
-	{
-		printf("Error could not open file %s", font);
-		return 0;
-	}
 
-	fseek(file, 0, SEEK_END);
-	size_t size = ftell(file);
-	rewind(file);
-
-	char* data = (char*)malloc(sizeof(char) * size);
-	if (!data)
+	// Initialize font must be done, this maps the TTF font file into memory
+	if (!Truetype::loadFont(fontInfo, font))
 	{
-		printf("Error could not allocate enough memory");
 		return 0;
 	}
-	// TODO: error check this, and read more if needed
-	size_t readAmt = fread(data, 1, size, file);
-
-	// Initialize font must be done, use binary data whatever was inside the TTF font file
-	Truetype::initFont(fontInfo, data, readAmt);
 
 	// Draw a png image with the glyph at the codepoint 0x00B6 to 'glyph.png'
 	Truetype::drawGlyph(0x00B6, fontInfo);
@@ -342,7 +312,7 @@ int main()
 	runGlWindow();
 
 	// Free the font after you are finished using it. This releases the 
-	// binary data that you allocated
+	// mapped font file
 	Truetype::freeFont(fontInfo);
 	return 0;
 }
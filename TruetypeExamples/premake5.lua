@@ -13,10 +13,15 @@ project "TruetypeExamples"
         "include/**.h",
 		"cpp/**.cpp",
 		"../Truetype/include/**.h",
+		"../Truetype/cpp/**.cpp",
 		"vendor/glmVendor/glm/**.hpp",
 		"vendor/glmVendor/glm/**.inl",
 	}
 
+	removefiles {
+		"../Truetype/cpp/main.cpp"
+	}
+
     disablewarnings { 
         "4251" 
     }
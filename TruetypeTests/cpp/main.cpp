@@ -1,38 +1,17 @@
 #include "glyph.h"
+#include "simd.h"
+#include "glyphCache.h"
+#include "outline.h"
+#include "metrics.h"
+#include "raster.h"
+
+#include <thread>
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
 
-struct File
-{
-	size_t size;
-	char* data;
-};
-
-File readFile(const char* filename)
-{
-	FILE* file = fopen(filename, "rb");
-	if (!file)
-	{
-		printf("Error could not open file %s", filename);
-		return {0, nullptr};
-	}
-
-	fseek(file, 0, SEEK_END);
-	size_t size = ftell(file);
-	rewind(file);
-
-	char* data = (char*)malloc(sizeof(char) * size);
-	if (!data)
-	{
-		printf("Error could not allocate enough memory");
-		return {0, nullptr};
-	}
-	size_t readAmt = fread(data, 1, size, file);
-	TTF_ASSERT(readAmt == size);
-
-	return { size, data };
-}
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_write.h"
 
 void testFontInfoMatch(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, const char* fontName) 
 {
@@ -45,8 +24,8 @@ void testFontInfoMatch(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, co
 	TTF_ASSERT(stbttFont.head == myFont.head);
 	TTF_ASSERT(stbttFont.hhea == myFont.hhea);
 	TTF_ASSERT(stbttFont.hmtx == myFont.hmtx);
-	//TTF_ASSERT(stbttFont.kern == myFont.kern);
-	//TTF_ASSERT(stbttFont.gpos == myFont.gpos);
+	TTF_ASSERT(stbttFont.kern == myFont.kern);
+	TTF_ASSERT(stbttFont.gpos == myFont.gpos);
 
 	// Test index format
 	TTF_ASSERT(stbttFont.indexToLocFormat == myFont.indexToLocFormat);
@@ -64,7 +43,8 @@ void testFontInfoMatch(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, co
 
 void testFontGlyphIdsMatch(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, const char* fontName)
 {
-	for (int i = 0; i < myFont.numGlyphs; i++)
+	// Every unicode codepoint, including the supplementary planes
+	for (int i = 0; i <= 0x10FFFF; i++)
 	{
 		int myGlyphId = Truetype::getGlyphId(i, myFont);
 		int stbGlyphId = stbtt_FindGlyphIndex(&stbttFont, i);
@@ -74,6 +54,1537 @@ void testFontGlyphIdsMatch(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont
 	printf("Glyph Ids all match for '%s'\n", fontName);
 }
 
+void testGlyphIdsBatchMatch(Truetype::FontInfo& myFont, const char* fontName)
+{
+	// Every codepoint in order, followed by a run that jumps between ranges
+	const int numCodepoints = 0x110000 + 4096;
+	Truetype::uint32* codepoints = (Truetype::uint32*)malloc(sizeof(Truetype::uint32) * numCodepoints);
+	Truetype::uint16* glyphIds = (Truetype::uint16*)malloc(sizeof(Truetype::uint16) * numCodepoints);
+	for (int i = 0; i < 0x110000; i++)
+	{
+		codepoints[i] = i;
+	}
+	for (int i = 0x110000; i < numCodepoints; i++)
+	{
+		codepoints[i] = ((Truetype::uint32)i * 2654435761u) % 0x110000;
+	}
+
+	Truetype::getGlyphIds(codepoints, numCodepoints, glyphIds, myFont);
+	for (int i = 0; i < numCodepoints; i++)
+	{
+		TTF_ASSERT(glyphIds[i] == Truetype::getGlyphId(codepoints[i], myFont));
+	}
+
+	free(codepoints);
+	free(glyphIds);
+	printf("Batched glyph Ids all match for '%s'\n", fontName);
+}
+
+void testGlyphPageTableMatch(stbtt_fontinfo& stbttFont, const char* fontName)
+{
+	Truetype::FontInfo pageTableFont;
+	bool loaded = Truetype::loadFont(pageTableFont, fontName, Truetype::FontLoadMode::MemoryMap, Truetype::INIT_GLYPH_PAGE_TABLE);
+	TTF_ASSERT(loaded);
+	TTF_ASSERT(pageTableFont.glyphPages != nullptr);
+
+	testFontGlyphIdsMatch(stbttFont, pageTableFont, fontName);
+	testGlyphIdsBatchMatch(pageTableFont, fontName);
+	printf("Font with glyph page table uses %u bytes for '%s'\n", (unsigned int)Truetype::getFontMemoryUsage(pageTableFont), fontName);
+
+	// A copy must not read page 0 out of the original
+	TTF_ASSERT(pageTableFont.glyphPages[0] == nullptr);
+	Truetype::FontInfo* fontCopy = (Truetype::FontInfo*)malloc(sizeof(Truetype::FontInfo));
+	memcpy(fontCopy, &pageTableFont, sizeof(Truetype::FontInfo));
+	memset(pageTableFont.latin1Page, 0xFF, sizeof(pageTableFont.latin1Page));
+	const int numCodepoints = 1024;
+	Truetype::uint32 codepoints[numCodepoints];
+	Truetype::uint16 glyphIds[numCodepoints];
+	for (int i = 0; i < numCodepoints; i++)
+	{
+		// Alternate between page 0 and the pages after it
+		codepoints[i] = (i & 1) ? 0x100 + i * 37 : i & 0xFF;
+	}
+	Truetype::getGlyphIds(codepoints, numCodepoints, glyphIds, *fontCopy);
+	for (int i = 0; i < numCodepoints; i++)
+	{
+		TTF_ASSERT(glyphIds[i] == stbtt_FindGlyphIndex(&stbttFont, codepoints[i]));
+		TTF_ASSERT(Truetype::getGlyphId(codepoints[i], *fontCopy) == stbtt_FindGlyphIndex(&stbttFont, codepoints[i]));
+	}
+	memcpy(pageTableFont.latin1Page, fontCopy->latin1Page, sizeof(pageTableFont.latin1Page));
+	free(fontCopy);
+
+	Truetype::freeFont(pageTableFont);
+}
+
+void testGlyphOffsetsMatch(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, const char* fontName)
+{
+	Truetype::FontInfo decodedLocaFont;
+	bool loaded = Truetype::loadFont(decodedLocaFont, fontName, Truetype::FontLoadMode::MemoryMap, Truetype::INIT_DECODE_LOCA);
+	TTF_ASSERT(loaded);
+	TTF_ASSERT(decodedLocaFont.glyphOffsets != nullptr);
+
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		TTF_ASSERT(Truetype::getGlyphSize(i, decodedLocaFont) == Truetype::getGlyphSize(i, myFont));
+
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, decodedLocaFont);
+		TTF_ASSERT((glyph.numberOfContours == 0) == (stbtt_IsGlyphEmpty(&stbttFont, i) != 0));
+
+		int x0, y0, x1, y1;
+		if (stbtt_GetGlyphBox(&stbttFont, i, &x0, &y0, &x1, &y1) && glyph.numberOfContours != 0)
+		{
+			TTF_ASSERT(glyph.xMin == x0 && glyph.yMin == y0 && glyph.xMax == x1 && glyph.yMax == y1);
+		}
+	}
+
+	Truetype::freeFont(decodedLocaFont);
+	printf("Glyph offsets all match for '%s'\n", fontName);
+}
+
+static bool closeTo(int a, int b)
+{
+	// Implied on curve points are rounded differently by stb_truetype
+	return a - b <= 1 && b - a <= 1;
+}
+
+// Checks that every on curve point of the decoded outline is an endpoint of the same segment in stb_truetype's shape
+static bool glyphDataMatchesShape(const Truetype::GlyphData& glyphData, const stbtt_vertex* vertices, int numVertices)
+{
+	int vertex = 0;
+	int contourBegin = 0;
+	for (int c = 0; c < glyphData.numContours; c++)
+	{
+		int contourEnd = glyphData.contourEnds[c];
+		if (vertex >= numVertices || vertices[vertex].type != STBTT_vmove ||
+			!closeTo(vertices[vertex].x, glyphData.xCoords[contourBegin]) || !closeTo(vertices[vertex].y, glyphData.yCoords[contourBegin]))
+		{
+			return false;
+		}
+		vertex++;
+
+		for (int p = contourBegin + 1; p <= contourEnd; p++)
+		{
+			if (!glyphData.flags[p])
+			{
+				continue;
+			}
+
+			bool isCurve = !glyphData.flags[p - 1];
+			if (vertex >= numVertices || vertices[vertex].type != (isCurve ? STBTT_vcurve : STBTT_vline) ||
+				!closeTo(vertices[vertex].x, glyphData.xCoords[p]) || !closeTo(vertices[vertex].y, glyphData.yCoords[p]))
+			{
+				return false;
+			}
+			if (isCurve && (!closeTo(vertices[vertex].cx, glyphData.xCoords[p - 1]) || !closeTo(vertices[vertex].cy, glyphData.yCoords[p - 1])))
+			{
+				return false;
+			}
+			vertex++;
+		}
+		contourBegin = contourEnd + 1;
+	}
+	return vertex == numVertices;
+}
+
+void testGlyphDataMatch(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, const char* fontName)
+{
+	int numCompared = 0;
+	int numComposites = 0;
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		// Composite glyphs are compared flattened
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		if (glyph.numberOfContours == 0)
+		{
+			continue;
+		}
+
+		Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+
+		// stb_truetype starts contours that begin with an off curve point somewhere else, only compare the others
+		bool startsOnCurve = true;
+		int contourBegin = 0;
+		for (int c = 0; c < glyphData.numContours; c++)
+		{
+			startsOnCurve = startsOnCurve && glyphData.flags[contourBegin];
+			contourBegin = glyphData.contourEnds[c] + 1;
+		}
+
+		if (startsOnCurve)
+		{
+			stbtt_vertex* vertices;
+			int numVertices = stbtt_GetGlyphShape(&stbttFont, i, &vertices);
+			TTF_ASSERT(glyphDataMatchesShape(glyphData, vertices, numVertices));
+			stbtt_FreeShape(&stbttFont, vertices);
+			numCompared++;
+			numComposites += glyph.numberOfContours < 0 ? 1 : 0;
+		}
+
+		Truetype::freeGlyphData(glyphData);
+	}
+
+	printf("Glyph data matches for %d glyphs (%d composite) in '%s'\n", numCompared, numComposites, fontName);
+}
+
+// stb_truetype's vertices are a move to the start of each contour, then one line or curve per segment
+static bool glyphSegmentsMatchShape(const Truetype::GlyphSegments& segments, const stbtt_vertex* vertices, int numVertices)
+{
+	int vertex = 0;
+	int segmentBegin = 0;
+	for (int c = 0; c < segments.numContours; c++)
+	{
+		int segmentEnd = segments.contourEnds[c];
+		if (vertex >= numVertices || vertices[vertex].type != STBTT_vmove)
+		{
+			return false;
+		}
+		vertex++;
+
+		for (int i = segmentBegin; i < segmentEnd; i++)
+		{
+			const Truetype::Segment& segment = segments.segments[i];
+			const stbtt_vertex& v = vertices[vertex];
+			const stbtt_vertex& previous = vertices[vertex - 1];
+			bool isQuad = segment.type == Truetype::SegmentType::Quad;
+			if (vertex >= numVertices || v.type != (isQuad ? STBTT_vcurve : STBTT_vline) ||
+				!closeTo(previous.x, segment.x0) || !closeTo(previous.y, segment.y0) ||
+				!closeTo(v.x, segment.x1) || !closeTo(v.y, segment.y1))
+			{
+				return false;
+			}
+			if (isQuad && (!closeTo(v.cx, segment.cx) || !closeTo(v.cy, segment.cy)))
+			{
+				return false;
+			}
+			if (!isQuad && (segment.cx != segment.x0 || segment.cy != segment.y0))
+			{
+				return false;
+			}
+			vertex++;
+		}
+		segmentBegin = segmentEnd;
+	}
+	return vertex == numVertices;
+}
+
+void testGlyphSegmentsMatch(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, const char* fontName)
+{
+	Truetype::Arena arena = Truetype::createArena();
+	Truetype::GlyphScratch scratch = Truetype::createGlyphScratch(myFont);
+	int numCompared = 0;
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+		Truetype::GlyphSegments segments = Truetype::getGlyphSegments(glyphData);
+		TTF_ASSERT(segments.numSegments == Truetype::countGlyphSegments(glyphData));
+
+		// The arena version has to produce the same segments
+		Truetype::GlyphSegments arenaSegments = Truetype::getGlyphSegments(glyph, myFont, scratch, arena);
+		TTF_ASSERT(arenaSegments.numContours == segments.numContours && arenaSegments.numSegments == segments.numSegments);
+		for (int s = 0; s < segments.numSegments; s++)
+		{
+			const Truetype::Segment& a = segments.segments[s];
+			const Truetype::Segment& b = arenaSegments.segments[s];
+			TTF_ASSERT(a.type == b.type && a.x0 == b.x0 && a.y0 == b.y0 && a.cx == b.cx && a.cy == b.cy && a.x1 == b.x1 && a.y1 == b.y1);
+		}
+
+		if (glyphData.numPoints > 0)
+		{
+			stbtt_vertex* vertices;
+			int numVertices = stbtt_GetGlyphShape(&stbttFont, i, &vertices);
+			TTF_ASSERT(glyphSegmentsMatchShape(segments, vertices, numVertices));
+			stbtt_FreeShape(&stbttFont, vertices);
+			numCompared++;
+		}
+
+		Truetype::freeGlyphSegments(segments);
+		Truetype::freeGlyphData(glyphData);
+		Truetype::resetArena(arena);
+	}
+
+	Truetype::freeGlyphScratch(scratch);
+	Truetype::freeArena(arena);
+	printf("Glyph segments match for %d glyphs in '%s'\n", numCompared, fontName);
+}
+
+void testGlyphSegmentIterator(Truetype::FontInfo& myFont, const char* fontName)
+{
+	int numCompared = 0;
+	int numFailed = 0;
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+		Truetype::GlyphSegments segments = Truetype::getGlyphSegments(glyphData);
+
+		// Walking the glyf data directly has to give the same segments as decoding it first
+		Truetype::SegmentIterator iterator;
+		Truetype::beginGlyphSegments(iterator, glyph, myFont);
+		Truetype::Segment segment;
+		int s = 0;
+		bool matches = true;
+		while (Truetype::nextGlyphSegment(iterator, segment))
+		{
+			const Truetype::Segment& expected = segments.segments[s];
+			matches = matches && s < segments.numSegments && segment.type == expected.type &&
+				segment.x0 == expected.x0 && segment.y0 == expected.y0 && segment.cx == expected.cx && segment.cy == expected.cy &&
+				segment.x1 == expected.x1 && segment.y1 == expected.y1;
+			s++;
+		}
+
+		if (iterator.failed)
+		{
+			numFailed++;
+		}
+		else
+		{
+			TTF_ASSERT(matches && s == segments.numSegments);
+			numCompared++;
+		}
+
+		Truetype::freeGlyphSegments(segments);
+		Truetype::freeGlyphData(glyphData);
+	}
+	printf("Segment iterator matches for %d glyphs in '%s', %d fell back\n", numCompared, fontName, numFailed);
+}
+
+static float distanceToLine(float px, float py, const Truetype::PolylinePoint& a, const Truetype::PolylinePoint& b)
+{
+	float dx = b.x - a.x;
+	float dy = b.y - a.y;
+	float lengthSquared = dx * dx + dy * dy;
+	float t = lengthSquared > 0.0f ? ((px - a.x) * dx + (py - a.y) * dy) / lengthSquared : 0.0f;
+	t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+	float x = a.x + t * dx - px;
+	float y = a.y + t * dy - py;
+	return sqrtf(x * x + y * y);
+}
+
+// Every line has to end on the curve and stay within tolerance of it in between
+static bool polylineFollowsSegments(const Truetype::GlyphPolyline& polyline, const Truetype::GlyphSegments& segments, float scale, float tolerance)
+{
+	int point = 0;
+	int segmentBegin = 0;
+	for (int c = 0; c < segments.numContours; c++)
+	{
+		int segmentEnd = segments.contourEnds[c];
+		if (segmentBegin == segmentEnd)
+		{
+			continue;
+		}
+
+		int contourStart = point;
+		point++;
+		for (int s = segmentBegin; s < segmentEnd; s++)
+		{
+			const Truetype::Segment& segment = segments.segments[s];
+			int numLines = Truetype::getSegmentSubdivisions(segment, scale, tolerance);
+			for (int i = 0; i < numLines; i++)
+			{
+				// For a quad split evenly, the furthest point from each chord is at the middle of its interval
+				float t = (i + 0.5f) / numLines;
+				float mt = 1.0f - t;
+				float x = (mt * mt * segment.x0 + 2.0f * mt * t * segment.cx + t * t * segment.x1) * scale;
+				float y = (mt * mt * segment.y0 + 2.0f * mt * t * segment.cy + t * t * segment.y1) * scale;
+				if (distanceToLine(x, y, polyline.points[point - 1], polyline.points[point]) > tolerance * 1.01f + 1e-3f)
+				{
+					return false;
+				}
+				point++;
+			}
+			if (polyline.points[point - 1].x != segment.x1 * scale || polyline.points[point - 1].y != segment.y1 * scale)
+			{
+				return false;
+			}
+		}
+
+		const Truetype::PolylinePoint& first = polyline.points[contourStart];
+		const Truetype::PolylinePoint& last = polyline.points[point - 1];
+		if (polyline.contourEnds[c] != point || first.x != last.x || first.y != last.y)
+		{
+			return false;
+		}
+		segmentBegin = segmentEnd;
+	}
+	return point == polyline.numPoints;
+}
+
+void testGlyphPolyline(Truetype::FontInfo& myFont, const char* fontName)
+{
+	const float tolerance = 0.25f;
+	const float pixelSizes[] = { 16.0f, 64.0f, 512.0f };
+	Truetype::Arena arena = Truetype::createArena();
+	int numPoints[3] = { 0, 0, 0 };
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		// One decode, flattened at every size
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+		Truetype::GlyphSegments segments = Truetype::getGlyphSegments(glyphData);
+		for (int size = 0; size < 3; size++)
+		{
+			float scale = pixelSizes[size] / myFont.unitsPerEm;
+			Truetype::GlyphPolyline polyline = Truetype::flattenGlyphSegments(segments, scale, tolerance, arena);
+			TTF_ASSERT(polylineFollowsSegments(polyline, segments, scale, tolerance));
+			numPoints[size] += polyline.numPoints;
+
+			// Caller memory gives the same points
+			size_t bytes = Truetype::getGlyphPolylineSize(segments, scale, tolerance);
+			void* memory = malloc(bytes > 0 ? bytes : 1);
+			Truetype::GlyphPolyline copy = Truetype::flattenGlyphSegments(segments, scale, tolerance, memory);
+			TTF_ASSERT(copy.numPoints == polyline.numPoints && copy.numContours == polyline.numContours);
+			TTF_ASSERT(polyline.numPoints == 0 || memcmp(copy.points, polyline.points, sizeof(Truetype::PolylinePoint) * polyline.numPoints) == 0);
+			free(memory);
+		}
+
+		Truetype::freeGlyphSegments(segments);
+		Truetype::freeGlyphData(glyphData);
+		Truetype::resetArena(arena);
+	}
+	Truetype::freeArena(arena);
+
+	// Bigger glyphs need more lines for the same pixel tolerance
+	TTF_ASSERT(numPoints[0] <= numPoints[1] && numPoints[1] <= numPoints[2]);
+	printf("Polylines stay within %.2f px for '%s', %d / %d / %d points at %.0f / %.0f / %.0f px\n", tolerance, fontName,
+		numPoints[0], numPoints[1], numPoints[2], pixelSizes[0], pixelSizes[1], pixelSizes[2]);
+}
+
+void testGlyphRasterScanline(Truetype::FontInfo& myFont, const char* fontName)
+{
+	// The winding path is slow, so the biggest size only checks every 16th glyph
+	const int pixelSizes[] = { 16, 64, 512 };
+	const int glyphSteps[] = { 1, 1, 16 };
+	Truetype::Arena arena = Truetype::createArena();
+	int numFilled[3] = { 0, 0, 0 };
+	for (int size = 0; size < 3; size++)
+	{
+		for (int i = 0; i < myFont.numGlyphs; i += glyphSteps[size])
+		{
+			Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+			Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+			Truetype::GlyphSegments segments = Truetype::getGlyphSegments(glyphData);
+
+			// A bitmap over the glyph's box at the pixel size
+			int width = (glyph.xMax - glyph.xMin) * pixelSizes[size] / myFont.unitsPerEm + 1;
+			int height = (glyph.yMax - glyph.yMin) * pixelSizes[size] / myFont.unitsPerEm + 1;
+			Truetype::uint8* winding = (Truetype::uint8*)malloc(width * height);
+			Truetype::uint8* scanline = (Truetype::uint8*)malloc(width * height);
+			Truetype::rasterizeGlyphWinding(segments, glyph, width, height, winding, arena);
+			Truetype::rasterizeGlyphScanline(segments, glyph, width, height, scanline, arena);
+			TTF_ASSERT(memcmp(winding, scanline, width * height) == 0);
+			for (int p = 0; p < width * height; p++)
+			{
+				numFilled[size] += scanline[p] != 0 ? 1 : 0;
+			}
+
+			// Scratch is released before returning
+			TTF_ASSERT(arena.bytesUsed == 0);
+
+			// One prepared outline renders every size, and its curves only rise or fall between their y extents
+			Truetype::PreparedOutline outline = Truetype::prepareGlyphOutline(segments, 1.0f, arena);
+			for (int c = 0; c < outline.numCurves; c++)
+			{
+				const float epsilon = 0.01f;
+				float a = outline.ay[c];
+				float b = outline.by[c];
+				float y0 = outline.cy[c];
+				float y1 = a + b + y0;
+				TTF_ASSERT(outline.minY[c] < outline.maxY[c] && (c == 0 || outline.minY[c - 1] <= outline.minY[c]));
+				TTF_ASSERT(fabsf(outline.minY[c] - std::min(y0, y1)) < epsilon && fabsf(outline.maxY[c] - std::max(y0, y1)) < epsilon);
+				TTF_ASSERT(outline.winding[c] == (y1 > y0 ? -1 : 1));
+
+				// The slope at both ends has the curve's direction
+				float direction = (float)-outline.winding[c];
+				TTF_ASSERT(b * direction > -epsilon && (2.0f * a + b) * direction > -epsilon);
+			}
+			memset(scanline, 0, width * height);
+			Truetype::rasterizeGlyphScanline(outline, glyph, width, height, scanline, arena);
+			TTF_ASSERT(memcmp(winding, scanline, width * height) == 0);
+			Truetype::resetArena(arena);
+			free(winding);
+			free(scanline);
+			Truetype::freeGlyphSegments(segments);
+			Truetype::freeGlyphData(glyphData);
+		}
+	}
+	Truetype::freeArena(arena);
+
+	printf("Scanline raster matches winding for '%s', %d / %d / %d pixels filled at %d / %d / %d px\n", fontName,
+		numFilled[0], numFilled[1], numFilled[2], pixelSizes[0], pixelSizes[1], pixelSizes[2]);
+}
+
+// Signed area of a closed polyline, from the shoelace formula
+static double polylineArea(const Truetype::GlyphPolyline& polyline)
+{
+	double area = 0.0;
+	int begin = 0;
+	for (int c = 0; c < polyline.numContours; c++)
+	{
+		int end = polyline.contourEnds[c];
+		for (int p = begin; p + 1 < end; p++)
+		{
+			area += (double)polyline.points[p].x * polyline.points[p + 1].y - (double)polyline.points[p + 1].x * polyline.points[p].y;
+		}
+		begin = end;
+	}
+	return area * 0.5;
+}
+
+void testCoverageClipping()
+{
+	// A quad whose left edge runs from (-10, 0) to (10, 10), so it starts outside a 10 x 10 bitmap and rows 0 to 4
+	// are entirely right of it. Clipping must not change the edge's slope.
+	Truetype::PolylinePoint points[] = { { -10.0f, 0.0f }, { 10.0f, 10.0f }, { 20.0f, 10.0f }, { 20.0f, 0.0f }, { -10.0f, 0.0f } };
+	int contourEnds[] = { 5 };
+	Truetype::GlyphPolyline polyline = { 1, contourEnds, 5, points };
+
+	const int size = 10;
+	const int margin = 20;
+	Truetype::uint8 clipped[size * size];
+	Truetype::uint8 whole[size * (size + 2 * margin)];
+	Truetype::Arena arena = Truetype::createArena();
+	Truetype::rasterizeGlyphCoverage(polyline, 0.0f, 0.0f, size, size, clipped, arena);
+	Truetype::rasterizeGlyphCoverage(polyline, (float)margin, 0.0f, size + 2 * margin, size, whole, arena);
+	Truetype::freeArena(arena);
+
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			int value = clipped[y * size + x];
+			TTF_ASSERT(y >= 5 || value == 255);
+			TTF_ASSERT(abs(value - whole[y * (size + 2 * margin) + margin + x]) <= 1);
+		}
+	}
+	printf("Coverage clips lines to the bitmap without changing their slope\n\n");
+}
+
+void testGlyphCoverage(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, const char* fontName)
+{
+	const float pixelSizes[] = { 16.0f, 64.0f, 512.0f };
+	const int glyphSteps[] = { 1, 1, 16 };
+	Truetype::Arena arena = Truetype::createArena();
+	double totalDifference[3] = { 0.0, 0.0, 0.0 };
+	int numPixels[3] = { 0, 0, 0 };
+	int numExact = 0;
+	int numGlyphs = 0;
+	for (int size = 0; size < 3; size++)
+	{
+		float scale = pixelSizes[size] / myFont.unitsPerEm;
+		for (int i = 0; i < myFont.numGlyphs; i += glyphSteps[size])
+		{
+			Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+			Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+			Truetype::GlyphSegments segments = Truetype::getGlyphSegments(glyphData);
+			Truetype::GlyphPolyline polyline = Truetype::flattenGlyphSegments(segments, scale, 0.25f, arena);
+
+			// The same pixel box stb picks
+			int x0 = (int)floorf(glyph.xMin * scale);
+			int y0 = (int)floorf(glyph.yMin * scale);
+			int width = (int)ceilf(glyph.xMax * scale) - x0;
+			int height = (int)ceilf(glyph.yMax * scale) - y0;
+			if (polyline.numPoints > 0 && width > 0 && height > 0)
+			{
+				Truetype::uint8* coverage = (Truetype::uint8*)malloc(width * height);
+				Truetype::uint8* scalar = (Truetype::uint8*)malloc(width * height);
+				Truetype::uint8* stb = (Truetype::uint8*)malloc(width * height);
+				Truetype::rasterizeGlyphCoverage(polyline, (float)-x0, (float)-y0, width, height, coverage, arena);
+				Truetype::setSimdEnabled(false);
+				Truetype::rasterizeGlyphCoverage(polyline, (float)-x0, (float)-y0, width, height, scalar, arena);
+				Truetype::setSimdEnabled(true);
+				stbtt_MakeGlyphBitmap(&stbttFont, stb, width, height, width, scale, scale, i);
+
+				// stb's rows go down from the top. It flattens curves more coarsely, which cuts their corners, so it
+				// only has to be close on average.
+				double coverageSum = 0.0;
+				double difference = 0.0;
+				for (int y = 0; y < height; y++)
+				{
+					for (int x = 0; x < width; x++)
+					{
+						int value = coverage[y * width + x];
+						TTF_ASSERT(abs(value - scalar[y * width + x]) <= 1);
+						difference += abs(value - stb[(height - 1 - y) * width + x]);
+						coverageSum += value / 255.0;
+					}
+				}
+				totalDifference[size] += difference;
+				numPixels[size] += width * height;
+
+				// A single contour can't overlap another one, so its coverage adds up to the polyline's area, up to
+				// rounding each pixel. Overlapping contours wind more than once and cover more than their area.
+				if (glyphData.numContours == 1)
+				{
+					double area = fabs(polylineArea(polyline));
+					numExact += fabs(coverageSum - area) <= 0.002 * width * height ? 1 : 0;
+					numGlyphs++;
+				}
+
+				free(coverage);
+				free(scalar);
+				free(stb);
+			}
+
+			Truetype::freeGlyphSegments(segments);
+			Truetype::freeGlyphData(glyphData);
+			Truetype::resetArena(arena);
+		}
+	}
+	Truetype::freeArena(arena);
+
+	for (int size = 0; size < 3; size++)
+	{
+		TTF_ASSERT(totalDifference[size] / numPixels[size] < 2.0);
+	}
+	TTF_ASSERT(numExact * 100 >= numGlyphs * 99);
+	printf("Coverage matches stb for '%s', mean difference %.2f / %.2f / %.2f at %.0f / %.0f / %.0f px, %d of %d single contour glyphs cover their exact area\n",
+		fontName, totalDifference[0] / numPixels[0], totalDifference[1] / numPixels[1], totalDifference[2] / numPixels[2],
+		pixelSizes[0], pixelSizes[1], pixelSizes[2], numExact, numGlyphs);
+}
+
+void testGlyphPlacement(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, const char* fontName)
+{
+	// A fractional size at a few subpixel offsets against stb, which shifts down where we shift up
+	const float pixelsPerEm = 13.5f;
+	const float subpixelOffsets[] = { 0.0f, 0.25f, 0.5f, 0.75f };
+	float scale = pixelsPerEm / myFont.unitsPerEm;
+	Truetype::Arena arena = Truetype::createArena();
+	double totalDifference = 0.0;
+	int numPixels = 0;
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		for (int o = 0; o < 4; o++)
+		{
+			float subpixelX = subpixelOffsets[o];
+			float subpixelY = subpixelOffsets[3 - o];
+			Truetype::GlyphPlacement placement = Truetype::createGlyphPlacement(pixelsPerEm, subpixelX, subpixelY);
+			Truetype::GlyphBitmap bitmap = Truetype::rasterizeGlyph(glyph, myFont, placement, arena);
+
+			int x0, y0, x1, y1;
+			stbtt_GetGlyphBitmapBoxSubpixel(&stbttFont, i, scale, scale, subpixelX, -subpixelY, &x0, &y0, &x1, &y1);
+			if (bitmap.width == 0)
+			{
+				continue;
+			}
+			TTF_ASSERT(bitmap.x == x0 && bitmap.y == -y1 && bitmap.width == x1 - x0 && bitmap.height == y1 - y0);
+
+			Truetype::uint8* stb = (Truetype::uint8*)malloc(bitmap.width * bitmap.height);
+			stbtt_MakeGlyphBitmapSubpixel(&stbttFont, stb, bitmap.width, bitmap.height, bitmap.width, scale, scale, subpixelX, -subpixelY, i);
+			for (int y = 0; y < bitmap.height; y++)
+			{
+				for (int x = 0; x < bitmap.width; x++)
+				{
+					totalDifference += abs(bitmap.pixels[y * bitmap.width + x] - stb[(bitmap.height - 1 - y) * bitmap.width + x]);
+				}
+			}
+			numPixels += bitmap.width * bitmap.height;
+			free(stb);
+
+			// Caller memory gives the same pixels
+			Truetype::GlyphBitmap copy = Truetype::getGlyphBitmapBox(glyph, myFont, placement);
+			copy.pixels = (Truetype::uint8*)malloc(copy.width * copy.height);
+			Truetype::rasterizeGlyph(glyph, myFont, placement, copy, arena);
+			TTF_ASSERT(memcmp(copy.pixels, bitmap.pixels, copy.width * copy.height) == 0);
+			free(copy.pixels);
+		}
+		Truetype::resetArena(arena);
+	}
+	TTF_ASSERT(totalDifference / numPixels < 2.0);
+
+	// A quarter turn moves pixel (x, y) to (height - 1 - y, x)
+	const Truetype::ComponentMatrix quarterTurn = { 0.0f, 1.0f, -1.0f, 0.0f };
+	int numRotated = 0;
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::GlyphBitmap bitmap = Truetype::rasterizeGlyph(glyph, myFont, Truetype::createGlyphPlacement(40.0f), arena);
+		Truetype::GlyphBitmap rotated = Truetype::rasterizeGlyph(glyph, myFont, Truetype::createGlyphPlacement(40.0f, quarterTurn), arena);
+		TTF_ASSERT(rotated.width == bitmap.height && rotated.height == bitmap.width);
+		TTF_ASSERT(rotated.x == -(bitmap.y + bitmap.height) && rotated.y == bitmap.x);
+		for (int y = 0; y < bitmap.height; y++)
+		{
+			for (int x = 0; x < bitmap.width; x++)
+			{
+				int value = bitmap.pixels[y * bitmap.width + x];
+				TTF_ASSERT(abs(value - rotated.pixels[x * rotated.width + (bitmap.height - 1 - y)]) <= 1);
+			}
+		}
+		numRotated += bitmap.width > 0 ? 1 : 0;
+
+		// Scaling through the matrix is the same as a bigger size
+		const Truetype::ComponentMatrix doubled = { 2.0f, 0.0f, 0.0f, 2.0f };
+		Truetype::GlyphBitmap scaled = Truetype::rasterizeGlyph(glyph, myFont, Truetype::createGlyphPlacement(20.0f, doubled), arena);
+		TTF_ASSERT(scaled.x == bitmap.x && scaled.y == bitmap.y && scaled.width == bitmap.width && scaled.height == bitmap.height);
+		TTF_ASSERT(bitmap.width == 0 || memcmp(scaled.pixels, bitmap.pixels, bitmap.width * bitmap.height) == 0);
+		Truetype::resetArena(arena);
+	}
+	Truetype::freeArena(arena);
+
+	printf("Placed glyphs match stb at %.1f px with subpixel offsets for '%s', mean difference %.2f, %d rotated\n", pixelsPerEm, fontName,
+		totalDifference / numPixels, numRotated);
+}
+
+void testGlyphBitmapStride(Truetype::FontInfo& myFont, const char* fontName)
+{
+	// Each glyph goes into a padded atlas row, a top down buffer, a cropped window and a 1-bit buffer, all checked
+	// against the packed render
+	const int padding = 5;
+	const Truetype::uint8 sentinel = 0xA5;
+	Truetype::Arena arena = Truetype::createArena();
+	int numChecked = 0;
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::GlyphPlacement placement = Truetype::createGlyphPlacement(24.0f, 0.3f, 0.6f);
+		Truetype::GlyphBitmap packed = Truetype::rasterizeGlyph(glyph, myFont, placement, arena);
+		if (packed.width == 0)
+		{
+			continue;
+		}
+		int width = packed.width;
+		int height = packed.height;
+
+		Truetype::GlyphBitmap padded = packed;
+		padded.stride = width + padding;
+		Truetype::uint8* paddedMemory = (Truetype::uint8*)malloc(padded.stride * height);
+		memset(paddedMemory, sentinel, padded.stride * height);
+		padded.pixels = paddedMemory;
+		Truetype::rasterizeGlyph(glyph, myFont, placement, padded, arena);
+		for (int y = 0; y < height; y++)
+		{
+			TTF_ASSERT(memcmp(paddedMemory + y * padded.stride, packed.pixels + y * width, width) == 0);
+			for (int x = width; x < padded.stride; x++)
+			{
+				TTF_ASSERT(paddedMemory[y * padded.stride + x] == sentinel);
+			}
+		}
+		free(paddedMemory);
+
+		// With a negative stride the bottom row is the last one in memory
+		Truetype::GlyphBitmap topDown = packed;
+		Truetype::uint8* topDownMemory = (Truetype::uint8*)malloc(width * height);
+		topDown.pixels = topDownMemory + (height - 1) * width;
+		topDown.stride = -width;
+		Truetype::rasterizeGlyph(glyph, myFont, placement, topDown, arena);
+		for (int y = 0; y < height; y++)
+		{
+			TTF_ASSERT(memcmp(topDownMemory + (height - 1 - y) * width, packed.pixels + y * width, width) == 0);
+		}
+		free(topDownMemory);
+
+		// A window smaller than the glyph, like a tile, clips the outline and gets the same pixels as the full render
+		Truetype::GlyphBitmap window = packed;
+		window.x += width / 4;
+		window.y += height / 4;
+		window.width = std::max(width / 2, 1);
+		window.height = std::max(height / 2, 1);
+		window.stride = window.width;
+		window.pixels = (Truetype::uint8*)malloc(window.width * window.height);
+		Truetype::rasterizeGlyph(glyph, myFont, placement, window, arena);
+		for (int y = 0; y < window.height; y++)
+		{
+			for (int x = 0; x < window.width; x++)
+			{
+				int full = packed.pixels[(y + height / 4) * width + x + width / 4];
+				TTF_ASSERT(abs(window.pixels[y * window.width + x] - full) <= 1);
+			}
+		}
+		free(window.pixels);
+
+		Truetype::GlyphBitmap mono = Truetype::rasterizeGlyph(glyph, myFont, placement, arena, Truetype::PixelFormat::Mono1);
+		TTF_ASSERT(mono.format == Truetype::PixelFormat::Mono1 && mono.stride == (width + 7) / 8);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < mono.stride * 8; x++)
+			{
+				bool set = (mono.pixels[y * mono.stride + x / 8] & (0x80 >> (x % 8))) != 0;
+				TTF_ASSERT(set == (x < width && packed.pixels[y * width + x] >= 128));
+			}
+		}
+		numChecked++;
+		Truetype::resetArena(arena);
+	}
+	Truetype::freeArena(arena);
+
+	printf("Strided, top down, cropped and 1-bit bitmaps match packed coverage for %d glyphs of '%s'\n", numChecked, fontName);
+}
+
+static int numAllocations = 0;
+
+static void* countingAllocate(size_t numBytes, void* userdata)
+{
+	numAllocations++;
+	return malloc(numBytes);
+}
+
+static void countingDeallocate(void* memory, void* userdata)
+{
+	free(memory);
+}
+
+static bool glyphDataEqual(const Truetype::GlyphData& a, const Truetype::GlyphData& b)
+{
+	if (a.numContours != b.numContours || a.numPoints != b.numPoints)
+	{
+		return false;
+	}
+	return a.numPoints == 0 || (
+		memcmp(a.contourEnds, b.contourEnds, sizeof(Truetype::uint16) * a.numContours) == 0 &&
+		memcmp(a.flags, b.flags, sizeof(Truetype::uint16) * a.numPoints) == 0 &&
+		memcmp(a.xCoords, b.xCoords, sizeof(Truetype::int16) * a.numPoints) == 0 &&
+		memcmp(a.yCoords, b.yCoords, sizeof(Truetype::int16) * a.numPoints) == 0);
+}
+
+void testGlyphScratchDecode(Truetype::FontInfo& myFont, const char* fontName)
+{
+	Truetype::GlyphScratch scratch = Truetype::createGlyphScratch(myFont);
+
+	// Decoding every glyph in the font into the scratch should never touch the allocator
+	Truetype::setAllocator(countingAllocate, countingDeallocate);
+	numAllocations = 0;
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::getGlyphData(glyph, myFont, scratch);
+	}
+	TTF_ASSERT(numAllocations == 0);
+	Truetype::setAllocator(nullptr, nullptr);
+
+	// And it should decode the same points as the allocating version
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::GlyphData scratchData = Truetype::getGlyphData(glyph, myFont, scratch);
+		Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+		TTF_ASSERT(glyphDataEqual(scratchData, glyphData));
+		Truetype::freeGlyphData(glyphData);
+	}
+
+	Truetype::freeGlyphScratch(scratch);
+	printf("Glyph scratch decodes without allocating in '%s'\n", fontName);
+}
+
+void testGlyphArenaDecode(Truetype::FontInfo& myFont, const char* fontName)
+{
+	// Small blocks so glyphs spill over block boundaries
+	Truetype::Arena arena = Truetype::createArena(4096);
+	Truetype::GlyphData* decoded = (Truetype::GlyphData*)malloc(sizeof(Truetype::GlyphData) * myFont.numGlyphs);
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		decoded[i] = Truetype::getGlyphData(glyph, myFont, arena);
+	}
+
+	// Everything stays valid until the arena is reset
+	size_t totalBytes = 0;
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+		TTF_ASSERT(glyphDataEqual(decoded[i], glyphData));
+		totalBytes += glyphData.numContours * 2 + glyphData.numPoints * 6;
+		Truetype::freeGlyphData(glyphData);
+	}
+	TTF_ASSERT(arena.bytesUsed >= totalBytes);
+	TTF_ASSERT(arena.peakBytesUsed >= arena.bytesUsed);
+	TTF_ASSERT(arena.numBlocksUsed == arena.numBlocks);
+
+	// A reset arena reuses its blocks instead of allocating
+	size_t peakBytes = arena.peakBytesUsed;
+	int numBlocks = arena.numBlocks;
+	Truetype::resetArena(arena);
+	TTF_ASSERT(arena.bytesUsed == 0);
+	Truetype::setAllocator(countingAllocate, countingDeallocate);
+	numAllocations = 0;
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::getGlyphData(glyph, myFont, arena);
+	}
+	TTF_ASSERT(numAllocations == 0);
+	Truetype::setAllocator(nullptr, nullptr);
+	TTF_ASSERT(arena.peakBytesUsed == peakBytes);
+	TTF_ASSERT(arena.numBlocks == numBlocks);
+
+	// Rewinding gives back exactly what was allocated after the marker
+	Truetype::ArenaMarker marker = Truetype::getArenaMarker(arena);
+	Truetype::arenaAllocate(arena, 100000);
+	Truetype::rewindArena(arena, marker);
+	TTF_ASSERT(arena.bytesUsed == marker.bytesUsed);
+
+	printf("Arena decode matches using %zu bytes in %d blocks for '%s'\n", peakBytes, numBlocks, fontName);
+	free(decoded);
+	Truetype::freeArena(arena);
+}
+
+void testHorizontalMetricsMatch(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, const char* fontName)
+{
+	int ascent, descent, lineGap;
+	stbtt_GetFontVMetrics(&stbttFont, &ascent, &descent, &lineGap);
+	TTF_ASSERT(myFont.ascender == ascent && myFont.descender == descent && myFont.lineGap == lineGap);
+
+	Truetype::FontInfo decodedFont;
+	if (!Truetype::loadFont(decodedFont, fontName, Truetype::FontLoadMode::MemoryMap, Truetype::INIT_DECODE_HMTX))
+	{
+		TTF_ASSERT(false);
+		return;
+	}
+	TTF_ASSERT(decodedFont.horizontalMetrics != nullptr);
+
+	// Both the decoded table and reading hmtx directly, including the lsb only glyphs past numberOfHMetrics
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		int advanceWidth, leftSideBearing;
+		stbtt_GetGlyphHMetrics(&stbttFont, i, &advanceWidth, &leftSideBearing);
+		Truetype::HorizontalMetrics metrics = Truetype::getHorizontalMetrics(i, myFont);
+		Truetype::HorizontalMetrics decodedMetrics = Truetype::getHorizontalMetrics(i, decodedFont);
+		TTF_ASSERT(metrics.advanceWidth == advanceWidth && metrics.leftSideBearing == leftSideBearing);
+		TTF_ASSERT(decodedMetrics.advanceWidth == advanceWidth && decodedMetrics.leftSideBearing == leftSideBearing);
+	}
+
+	Truetype::freeFont(decodedFont);
+	printf("Horizontal metrics match for %d glyphs (%d long) in '%s'\n", myFont.numGlyphs, myFont.numberOfHMetrics, fontName);
+}
+
+void testKerningMatch(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, const char* fontName)
+{
+	// stb only reads version 1.0 GPOS tables
+	const Truetype::uint8* gpos = stbttFont.gpos ? stbttFont.data + stbttFont.gpos : nullptr;
+	bool stbReadsGpos = gpos && Truetype::loadUint16(gpos) == 1 && Truetype::loadUint16(gpos + 2) == 0;
+
+	// Every pair of the first 1024 glyphs against stb's kern table and GPOS lookups
+	int numGlyphs = myFont.numGlyphs < 1024 ? myFont.numGlyphs : 1024;
+	int numKerned = 0;
+	int numGposKerned = 0;
+	for (int left = 0; left < numGlyphs; left++)
+	{
+		for (int right = 0; right < numGlyphs; right++)
+		{
+			int kerning = Truetype::getKernTableKerning(left, right, myFont);
+			TTF_ASSERT(kerning == stbtt__GetGlyphKernInfoAdvance(&stbttFont, left, right));
+			numKerned += kerning != 0 ? 1 : 0;
+
+			int gposKerning = Truetype::getGposKerning(left, right, myFont);
+			if (stbReadsGpos)
+			{
+				TTF_ASSERT(gposKerning == stbtt__GetGlyphGPOSInfoAdvance(&stbttFont, left, right));
+			}
+			numGposKerned += gposKerning != 0 ? 1 : 0;
+
+			// stb adds both tables up, the kern table only counts when GPOS has no kerning
+			TTF_ASSERT(Truetype::getKerning(left, right, myFont) == (myFont.numGposLookups > 0 ? gposKerning : kerning));
+		}
+	}
+
+	// The batch version has to agree with single lookups for every adjacent pair
+	const int runLength = 4096;
+	Truetype::uint16 glyphIds[runLength];
+	Truetype::int16 kerning[runLength];
+	for (int i = 0; i < runLength; i++)
+	{
+		glyphIds[i] = (Truetype::uint16)((i * 7919) % myFont.numGlyphs);
+	}
+	Truetype::getKerning(glyphIds, runLength, kerning, myFont);
+	for (int i = 0; i + 1 < runLength; i++)
+	{
+		TTF_ASSERT(kerning[i] == Truetype::getKerning(glyphIds[i], glyphIds[i + 1], myFont));
+	}
+	TTF_ASSERT(kerning[runLength - 1] == 0);
+
+	int numClassSubtables = 0;
+	for (int l = 0; l < myFont.numGposLookups; l++)
+	{
+		numClassSubtables += myFont.gposLookups[l].numClassSubtables;
+	}
+	printf("Kern table matches for %d kerned pairs (%d in table) in '%s'\n", numKerned, myFont.numKernPairs, fontName);
+	printf("GPOS matches for %d kerned pairs (%d lookups, %d class subtables) in '%s'\n", numGposKerned, myFont.numGposLookups, numClassSubtables, fontName);
+}
+
+void testCompositeCacheMatch(Truetype::FontInfo& myFont, const char* fontName)
+{
+	Truetype::FontInfo cachedFont;
+	if (!Truetype::loadFont(cachedFont, fontName, Truetype::FontLoadMode::MemoryMap, Truetype::INIT_CACHE_COMPOSITES))
+	{
+		TTF_ASSERT(false);
+		return;
+	}
+
+	int numComposites = 0;
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+		Truetype::GlyphData cachedData = Truetype::getGlyphData(Truetype::getGlyphById(i, cachedFont), cachedFont);
+		TTF_ASSERT(glyphDataEqual(glyphData, cachedData));
+		numComposites += glyph.numberOfContours < 0 ? 1 : 0;
+		Truetype::freeGlyphData(glyphData);
+		Truetype::freeGlyphData(cachedData);
+	}
+
+	Truetype::freeFont(cachedFont);
+	printf("Cached composites match for %d glyphs in '%s'\n", numComposites, fontName);
+}
+
+void testGlyphCache(Truetype::FontInfo& myFont, const char* fontName)
+{
+	// With room for every glyph, the first pass misses on everything and the second one hits
+	Truetype::GlyphCache* cache = Truetype::createGlyphCache(16 * 1024 * 1024);
+	Truetype::GlyphScratch scratch = Truetype::createGlyphScratch(myFont);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (int i = 0; i < myFont.numGlyphs; i++)
+		{
+			Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+			Truetype::GlyphData cachedData = Truetype::getGlyphData(*cache, glyph, myFont, scratch);
+			Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+			TTF_ASSERT(glyphDataEqual(cachedData, glyphData));
+			Truetype::freeGlyphData(glyphData);
+		}
+	}
+	Truetype::GlyphCacheStats stats = Truetype::getGlyphCacheStats(*cache);
+	TTF_ASSERT(stats.misses == (Truetype::uint64)myFont.numGlyphs);
+	TTF_ASSERT(stats.hits == (Truetype::uint64)myFont.numGlyphs);
+	TTF_ASSERT(stats.evictions == 0);
+	TTF_ASSERT(stats.numEntries == myFont.numGlyphs);
+
+	Truetype::evictFont(*cache, myFont);
+	stats = Truetype::getGlyphCacheStats(*cache);
+	TTF_ASSERT(stats.numEntries == 0 && stats.bytesUsed == 0);
+	Truetype::freeGlyphCache(cache);
+
+	// A small budget has to evict, but never goes over
+	cache = Truetype::createGlyphCache(16 * 1024, 4);
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::getGlyphData(*cache, Truetype::getGlyphById(i, myFont), myFont, scratch);
+		TTF_ASSERT(Truetype::getGlyphCacheStats(*cache).bytesUsed <= 16 * 1024);
+	}
+	stats = Truetype::getGlyphCacheStats(*cache);
+	TTF_ASSERT(stats.evictions > 0);
+	Truetype::freeGlyphCache(cache);
+	Truetype::freeGlyphScratch(scratch);
+
+	// Many threads sharing one cache all get the right outlines
+	cache = Truetype::createGlyphCache(64 * 1024, 8);
+	const int numThreads = 4;
+	bool threadMatches[numThreads];
+	std::thread threads[numThreads];
+	for (int t = 0; t < numThreads; t++)
+	{
+		threads[t] = std::thread([&, t]()
+		{
+			Truetype::GlyphScratch threadScratch = Truetype::createGlyphScratch(myFont);
+			bool matches = true;
+			for (int pass = 0; pass < 4; pass++)
+			{
+				for (int i = 0; i < myFont.numGlyphs; i++)
+				{
+					int glyphId = (i * (t + 1)) % myFont.numGlyphs;
+					Truetype::Glyph glyph = Truetype::getGlyphById(glyphId, myFont);
+					Truetype::GlyphData cachedData = Truetype::getGlyphData(*cache, glyph, myFont, threadScratch);
+					Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, myFont);
+					matches = matches && glyphDataEqual(cachedData, glyphData);
+					Truetype::freeGlyphData(glyphData);
+				}
+			}
+			Truetype::freeGlyphScratch(threadScratch);
+			threadMatches[t] = matches;
+		});
+	}
+	for (int t = 0; t < numThreads; t++)
+	{
+		threads[t].join();
+		TTF_ASSERT(threadMatches[t]);
+	}
+	stats = Truetype::getGlyphCacheStats(*cache);
+	TTF_ASSERT(stats.hits + stats.misses == (Truetype::uint64)myFont.numGlyphs * 4 * numThreads);
+	Truetype::freeGlyphCache(cache);
+
+	printf("Glyph cache matches for '%s'\n", fontName);
+}
+
+static char* readWholeFile(const char* filepath, long& size)
+{
+	FILE* file = fopen(filepath, "rb");
+	if (!file)
+	{
+		size = 0;
+		return nullptr;
+	}
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* data = (char*)malloc(size);
+	fread(data, size, 1, file);
+	fclose(file);
+	return data;
+}
+
+void testWriteGlyphBitmap(Truetype::FontInfo& myFont, const char* fontName)
+{
+	// The png written from a bottom up bitmap has to match one stb writes from the same rows top down. stb writing
+	// the second one flipped would mean its global flip flag was left on.
+	Truetype::Arena arena = Truetype::createArena();
+	Truetype::Glyph glyph = Truetype::getGlyph('A', myFont);
+	Truetype::GlyphPlacement placement = Truetype::createGlyphPlacement(24.0f, 0.0f, 0.0f);
+	for (Truetype::PixelFormat format : { Truetype::PixelFormat::Alpha8, Truetype::PixelFormat::Mono1 })
+	{
+		Truetype::GlyphBitmap bitmap = Truetype::rasterizeGlyph(glyph, myFont, placement, arena, format);
+		if (bitmap.width == 0)
+		{
+			printf("No 'A' to write in '%s'\n", fontName);
+			break;
+		}
+		bool saved = Truetype::writeGlyphBitmap(bitmap, "glyphBitmap.png");
+		TTF_ASSERT(saved);
+
+		Truetype::uint8* topDown = (Truetype::uint8*)malloc(bitmap.width * bitmap.height);
+		for (int y = 0; y < bitmap.height; y++)
+		{
+			const Truetype::uint8* row = bitmap.pixels + y * bitmap.stride;
+			for (int x = 0; x < bitmap.width; x++)
+			{
+				bool mono = format == Truetype::PixelFormat::Mono1;
+				Truetype::uint8 value = mono ? ((row[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0) : row[x];
+				topDown[(bitmap.height - 1 - y) * bitmap.width + x] = value;
+			}
+		}
+		saved = stbi_write_png("glyphBitmapTopDown.png", bitmap.width, bitmap.height, 1, topDown, bitmap.width) != 0;
+		TTF_ASSERT(saved);
+		free(topDown);
+
+		long writtenSize;
+		long expectedSize;
+		char* written = readWholeFile("glyphBitmap.png", writtenSize);
+		char* expected = readWholeFile("glyphBitmapTopDown.png", expectedSize);
+		TTF_ASSERT(written != nullptr && writtenSize == expectedSize && memcmp(written, expected, writtenSize) == 0);
+		free(written);
+		free(expected);
+		Truetype::resetArena(arena);
+	}
+	Truetype::freeArena(arena);
+
+	printf("Written glyph bitmaps are the right way up for '%s'\n", fontName);
+}
+
+void testInternalFontParallelMatch(Truetype::FontInfo& myFont, const char* fontName)
+{
+	Truetype::uint32 serialSize = Truetype::writeInternalFont(myFont, "internalFontSerial.bin", 1);
+	Truetype::uint32 parallelSize = Truetype::writeInternalFont(myFont, "internalFontParallel.bin", 4);
+	TTF_ASSERT(serialSize == parallelSize);
+
+	long serialBytes, parallelBytes;
+	char* serial = readWholeFile("internalFontSerial.bin", serialBytes);
+	char* parallel = readWholeFile("internalFontParallel.bin", parallelBytes);
+	TTF_ASSERT(serial != nullptr && serialBytes == parallelBytes && memcmp(serial, parallel, serialBytes) == 0);
+	free(serial);
+	free(parallel);
+	remove("internalFontSerial.bin");
+	remove("internalFontParallel.bin");
+
+	printf("Parallel internal font matches serial for '%s'\n", fontName);
+}
+
+void testMalformedContourEnds(const char* fontName)
+{
+	// Contour ends that go back down, like [M, 0, ...], would make the decoders write more points than they counted
+	long fontSize;
+	char* fontData = readWholeFile(fontName, fontSize);
+	TTF_ASSERT(fontData != nullptr);
+	Truetype::FontInfo badFont;
+	bool loaded = Truetype::initFont(badFont, fontData, (int)fontSize);
+	TTF_ASSERT(loaded);
+
+	int badGlyph = -1;
+	for (int i = 0; i < badFont.numGlyphs && badGlyph < 0; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, badFont);
+		if (glyph.simpleGlyphTable != nullptr && glyph.numberOfContours >= 2)
+		{
+			Truetype::uint8* contourEnds = glyph.simpleGlyphTable;
+			int last = (glyph.numberOfContours - 1) * 2;
+			contourEnds[0] = contourEnds[last];
+			contourEnds[1] = contourEnds[last + 1];
+			contourEnds[2] = 0;
+			contourEnds[3] = 0;
+			badGlyph = i;
+		}
+	}
+	TTF_ASSERT(badGlyph >= 0);
+
+	// Every reader rejects the glyph instead of overrunning its arrays
+	Truetype::Glyph glyph = Truetype::getGlyphById(badGlyph, badFont);
+	Truetype::SimpleGlyphLayout layout;
+	TTF_ASSERT(!Truetype::getSimpleGlyphLayout(glyph, badFont, layout));
+
+	Truetype::GlyphData glyphData = Truetype::getGlyphData(glyph, badFont);
+	TTF_ASSERT(glyphData.numContours == 0 && glyphData.numPoints == 0);
+	Truetype::GlyphSegments segments = Truetype::getGlyphSegments(glyphData);
+	TTF_ASSERT(segments.numSegments == 0);
+	Truetype::freeGlyphSegments(segments);
+	Truetype::freeGlyphData(glyphData);
+
+	Truetype::GlyphScratch scratch = Truetype::createGlyphScratch(badFont);
+	TTF_ASSERT(Truetype::getGlyphData(glyph, badFont, scratch).numPoints == 0);
+	Truetype::freeGlyphScratch(scratch);
+
+	Truetype::Arena arena = Truetype::createArena();
+	TTF_ASSERT(Truetype::getGlyphData(glyph, badFont, arena).numPoints == 0);
+	Truetype::freeArena(arena);
+
+	Truetype::SegmentIterator iterator;
+	Truetype::beginGlyphSegments(iterator, glyph, badFont);
+	Truetype::Segment segment;
+	TTF_ASSERT(!Truetype::nextGlyphSegment(iterator, segment) && iterator.failed);
+
+	Truetype::freeFont(badFont);
+	printf("Glyph %d with decreasing contour ends is rejected in '%s'\n", badGlyph, fontName);
+}
+
+void testMaxpWithoutGlyphMaxima(Truetype::FontInfo& myFont, const char* fontName)
+{
+	// A version 0.5 maxp stops after numGlyphs, so the largest glyph sizes come from the glyphs themselves
+	long fontSize;
+	char* fontData = readWholeFile(fontName, fontSize);
+	TTF_ASSERT(fontData != nullptr);
+	Truetype::uint32 maxpOffset = Truetype::findTableOffset(fontData, "maxp");
+	TTF_ASSERT(maxpOffset != 0);
+	const Truetype::uint8 version[] = { 0, 0, 0x50, 0 };
+	memcpy(fontData + maxpOffset, version, sizeof(version));
+
+	Truetype::FontInfo shortMaxpFont;
+	bool loaded = Truetype::initFont(shortMaxpFont, fontData, (int)fontSize);
+	TTF_ASSERT(loaded);
+	TTF_ASSERT(shortMaxpFont.maxPoints > 0 && shortMaxpFont.maxPoints <= myFont.maxPoints);
+	TTF_ASSERT(shortMaxpFont.maxContours > 0 && shortMaxpFont.maxContours <= myFont.maxContours);
+
+	Truetype::GlyphScratch scratch = Truetype::createGlyphScratch(shortMaxpFont);
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::GlyphData expected = Truetype::getGlyphData(Truetype::getGlyphById(i, myFont), myFont);
+		Truetype::GlyphData glyphData = Truetype::getGlyphData(Truetype::getGlyphById(i, shortMaxpFont), shortMaxpFont, scratch);
+		TTF_ASSERT(glyphDataEqual(glyphData, expected));
+		Truetype::freeGlyphData(expected);
+	}
+	Truetype::freeGlyphScratch(scratch);
+
+	Truetype::freeFont(shortMaxpFont);
+	printf("Glyph sizes are found without maxp for '%s'\n", fontName);
+}
+
+static void storeUint32(Truetype::uint8* p, Truetype::uint32 value)
+{
+	p[0] = (Truetype::uint8)(value >> 24);
+	p[1] = (Truetype::uint8)(value >> 16);
+	p[2] = (Truetype::uint8)(value >> 8);
+	p[3] = (Truetype::uint8)value;
+}
+
+void testFontCollection(stbtt_fontinfo& stbttFont, Truetype::FontInfo& myFont, const char* fontName)
+{
+	// A two font .ttc built around the file: the font itself, then a second table directory pointing at the same tables
+	long fontSize;
+	char* fontData = readWholeFile(fontName, fontSize);
+	TTF_ASSERT(fontData != nullptr);
+	int numTables = Truetype::toUShort((Truetype::uint8*)fontData + 4);
+	int directorySize = 12 + numTables * 16;
+	int headerSize = 20;
+	int secondStart = headerSize + (int)((fontSize + 3) & ~3);
+	int collectionSize = secondStart + directorySize;
+	Truetype::uint8* collection = (Truetype::uint8*)calloc(collectionSize, 1);
+	const Truetype::uint8 header[] = { 't', 't', 'c', 'f', 0, 1, 0, 0, 0, 0, 0, 2 };
+	memcpy(collection, header, sizeof(header));
+	storeUint32(collection + 12, headerSize);
+	storeUint32(collection + 16, secondStart);
+	memcpy(collection + headerSize, fontData, fontSize);
+	memcpy(collection + secondStart, fontData, directorySize);
+	for (int i = 0; i < numTables; i++)
+	{
+		// Table offsets in a collection are from the start of the file
+		for (int start : { headerSize, secondStart })
+		{
+			Truetype::uint8* offset = collection + start + 12 + i * 16 + 8;
+			storeUint32(offset, Truetype::toULong(offset) + headerSize);
+		}
+	}
+	free(fontData);
+	TTF_ASSERT(Truetype::getNumFonts((const char*)collection, collectionSize) == 2);
+	TTF_ASSERT(Truetype::getNumFonts(myFont.data, myFont.fontSize) == 1);
+
+	// Both fonts read like the original and stb agrees on where they start
+	for (int index = 0; index < 2; index++)
+	{
+		char* copy = (char*)malloc(collectionSize);
+		memcpy(copy, collection, collectionSize);
+		Truetype::FontInfo collectionFont;
+		bool loaded = Truetype::initFont(collectionFont, copy, collectionSize, Truetype::INIT_DEFAULT, index);
+		TTF_ASSERT(loaded);
+		TTF_ASSERT(collectionFont.fontStart == stbtt_GetFontOffsetForIndex(collection, index));
+		TTF_ASSERT(collectionFont.numGlyphs == myFont.numGlyphs && collectionFont.unitsPerEm == myFont.unitsPerEm);
+		TTF_ASSERT(Truetype::checkCompatibility(collectionFont));
+		for (int i = 0; i < myFont.numGlyphs; i += 7)
+		{
+			TTF_ASSERT(Truetype::getGlyphId(i + 32, collectionFont) == stbtt_FindGlyphIndex(&stbttFont, i + 32));
+			Truetype::GlyphData expected = Truetype::getGlyphData(Truetype::getGlyphById(i, myFont), myFont);
+			Truetype::GlyphData glyphData = Truetype::getGlyphData(Truetype::getGlyphById(i, collectionFont), collectionFont);
+			TTF_ASSERT(glyphDataEqual(glyphData, expected));
+			Truetype::freeGlyphData(glyphData);
+			Truetype::freeGlyphData(expected);
+		}
+		Truetype::freeFont(collectionFont);
+	}
+
+	// There is no third font
+	char* copy = (char*)malloc(collectionSize);
+	memcpy(copy, collection, collectionSize);
+	Truetype::FontInfo missingFont;
+	bool loaded = Truetype::initFont(missingFont, copy, collectionSize, Truetype::INIT_DEFAULT, 2);
+	TTF_ASSERT(!loaded);
+	Truetype::freeFont(missingFont);
+	free(collection);
+
+	printf("Both fonts of a collection built from '%s' match it\n", fontName);
+}
+
+static Truetype::uint8* findTableRecord(char* fontData, const char* tag)
+{
+	int numTables = Truetype::toUShort((Truetype::uint8*)fontData + 4);
+	for (int i = 0; i < numTables; i++)
+	{
+		Truetype::uint8* record = (Truetype::uint8*)fontData + 12 + i * 16;
+		if (memcmp(record, tag, 4) == 0)
+		{
+			return record;
+		}
+	}
+	return nullptr;
+}
+
+void testLastResortCmap(Truetype::FontInfo& myFont, const char* fontName)
+{
+	// A format 13 subtable that maps every codepoint to glyph 1, appended after the font
+	long fontSize;
+	char* fontData = readWholeFile(fontName, fontSize);
+	TTF_ASSERT(fontData != nullptr);
+	int subtableStart = (int)((fontSize + 3) & ~3);
+	int extendedSize = subtableStart + 28;
+	Truetype::uint8* extended = (Truetype::uint8*)calloc(extendedSize, 1);
+	memcpy(extended, fontData, fontSize);
+	free(fontData);
+	Truetype::uint8* subtable = extended + subtableStart;
+	subtable[1] = 13;
+	storeUint32(subtable + 4, 28);
+	storeUint32(subtable + 12, 1);
+	storeUint32(subtable + 20, 0x10FFFF);
+	storeUint32(subtable + 24, 1);
+
+	Truetype::uint32 cmapOffset = Truetype::findTableOffset((char*)extended, "cmap");
+	Truetype::uint8* cmap = extended + cmapOffset;
+	int numRecords = Truetype::toUShort(cmap + 2);
+	Truetype::uint32 usedOffset = (Truetype::uint32)myFont.cmap - cmapOffset;
+	int spareRecord = -1;
+	for (int i = 0; i < numRecords && spareRecord < 0; i++)
+	{
+		spareRecord = Truetype::toULong(cmap + 8 + i * 8) != usedOffset ? i : -1;
+	}
+	if (spareRecord < 0)
+	{
+		free(extended);
+		printf("No spare cmap record to add a last resort subtable to in '%s'\n", fontName);
+		return;
+	}
+
+	// Next to the subtable the font already uses, format 13 is ignored
+	const Truetype::uint8 lastResortRecord[] = { 0, 0, 0, 6 };
+	memcpy(cmap + 4 + spareRecord * 8, lastResortRecord, sizeof(lastResortRecord));
+	storeUint32(cmap + 8 + spareRecord * 8, subtableStart - cmapOffset);
+	char* withLastResort = (char*)malloc(extendedSize);
+	memcpy(withLastResort, extended, extendedSize);
+	Truetype::FontInfo lastResortFont;
+	bool loaded = Truetype::initFont(lastResortFont, withLastResort, extendedSize);
+	TTF_ASSERT(loaded);
+	TTF_ASSERT(lastResortFont.cmapFormat == myFont.cmapFormat);
+	for (Truetype::uint32 codepoint = 0; codepoint < 0x20000; codepoint++)
+	{
+		TTF_ASSERT(Truetype::getGlyphId(codepoint, lastResortFont) == Truetype::getGlyphId(codepoint, myFont));
+	}
+	Truetype::freeFont(lastResortFont);
+
+	// On its own it is still used
+	for (int i = 0; i < numRecords; i++)
+	{
+		memcpy(cmap + 4 + i * 8, lastResortRecord, sizeof(lastResortRecord));
+		storeUint32(cmap + 8 + i * 8, subtableStart - cmapOffset);
+	}
+	loaded = Truetype::initFont(lastResortFont, (char*)extended, extendedSize);
+	TTF_ASSERT(loaded);
+	TTF_ASSERT(lastResortFont.cmapFormat == 13);
+	TTF_ASSERT(Truetype::getGlyphId('A', lastResortFont) == 1 && Truetype::getGlyphId(0x1F600, lastResortFont) == 1);
+	Truetype::freeFont(lastResortFont);
+
+	printf("Last resort cmap subtable is only used on its own in '%s'\n", fontName);
+}
+
+void testGposClassCountOverflow(Truetype::FontInfo& myFont, const char* fontName)
+{
+	int numClassSubtables = 0;
+	for (int l = 0; l < myFont.numGposLookups; l++)
+	{
+		numClassSubtables += myFont.gposLookups[l].numClassSubtables;
+	}
+	if (numClassSubtables == 0)
+	{
+		printf("No GPOS class subtables to overflow in '%s'\n", fontName);
+		return;
+	}
+
+	// 46341 x 46341 classes of 2 byte records is just over 4 GB, which wraps around to 9266 bytes in 32 bits
+	long fontSize;
+	char* fontData = readWholeFile(fontName, fontSize);
+	TTF_ASSERT(fontData != nullptr);
+	Truetype::uint8* gpos = (Truetype::uint8*)fontData + Truetype::findTableOffset(fontData, "GPOS");
+	Truetype::uint8* lookupList = gpos + Truetype::toUShort(gpos + 8);
+	for (int l = 0; l < Truetype::toUShort(lookupList); l++)
+	{
+		Truetype::uint8* lookup = lookupList + Truetype::toUShort(lookupList + 2 + l * 2);
+		for (int i = 0; i < Truetype::toUShort(lookup + 4); i++)
+		{
+			Truetype::uint8* subtable = lookup + Truetype::toUShort(lookup + 6 + i * 2);
+			int lookupType = Truetype::toUShort(lookup);
+			if (lookupType == 9)
+			{
+				lookupType = Truetype::toUShort(subtable + 2);
+				subtable += Truetype::toULong(subtable + 4);
+			}
+			if (lookupType == 2 && Truetype::toUShort(subtable) == 2)
+			{
+				// Only an x advance for the first glyph, then the class counts
+				const Truetype::uint8 valueFormats[] = { 0, 4, 0, 0 };
+				const Truetype::uint8 classCounts[] = { 0xB5, 0x05, 0xB5, 0x05 };
+				memcpy(subtable + 4, valueFormats, sizeof(valueFormats));
+				memcpy(subtable + 12, classCounts, sizeof(classCounts));
+			}
+		}
+	}
+
+	Truetype::FontInfo overflowFont;
+	bool loaded = Truetype::initFont(overflowFont, fontData, (int)fontSize);
+	TTF_ASSERT(loaded);
+	for (int l = 0; l < overflowFont.numGposLookups; l++)
+	{
+		TTF_ASSERT(overflowFont.gposLookups[l].numClassSubtables == 0);
+	}
+	Truetype::freeFont(overflowFont);
+	printf("GPOS class subtables too large for the table are dropped in '%s'\n", fontName);
+}
+
+void testShortTables(Truetype::FontInfo& myFont, const char* fontName)
+{
+	// A loca table that ends early, read in place and decoded, only keeps the glyphs it has offsets for
+	int numGlyphs = myFont.numGlyphs / 2;
+	int locaEntrySize = myFont.indexToLocFormat == 0 ? 2 : 4;
+	for (Truetype::uint32 initFlags : { Truetype::INIT_DEFAULT, Truetype::INIT_DECODE_LOCA })
+	{
+		long fontSize;
+		char* fontData = readWholeFile(fontName, fontSize);
+		TTF_ASSERT(fontData != nullptr);
+		storeUint32(findTableRecord(fontData, "loca") + 12, (numGlyphs + 1) * locaEntrySize + locaEntrySize - 1);
+
+		Truetype::FontInfo shortLocaFont;
+		bool loaded = Truetype::initFont(shortLocaFont, fontData, (int)fontSize, initFlags);
+		TTF_ASSERT(loaded);
+		TTF_ASSERT(shortLocaFont.numGlyphs == numGlyphs);
+		TTF_ASSERT(Truetype::getGlyphSize(numGlyphs, shortLocaFont) == 0);
+		for (int i = 0; i < numGlyphs; i++)
+		{
+			TTF_ASSERT(Truetype::getGlyphSize(i, shortLocaFont) == Truetype::getGlyphSize(i, myFont));
+		}
+		Truetype::freeFont(shortLocaFont);
+	}
+
+	// head and maxp that are too short to read are rejected
+	for (const char* tag : { "head", "maxp" })
+	{
+		long fontSize;
+		char* fontData = readWholeFile(fontName, fontSize);
+		TTF_ASSERT(fontData != nullptr);
+		storeUint32(findTableRecord(fontData, tag) + 12, 4);
+		Truetype::FontInfo shortFont;
+		bool loaded = Truetype::initFont(shortFont, fontData, (int)fontSize);
+		TTF_ASSERT(!loaded);
+		Truetype::freeFont(shortFont);
+	}
+
+	printf("Short loca, head and maxp tables are caught for '%s'\n", fontName);
+}
+
+void testKernEmptySlotKey(const char* fontName)
+{
+	// A kern pair of glyphs 0xFFFF and 0xFFFF has the key that marks empty hash slots. Storing its value would make
+	// every lookup that probes into that slot return it.
+	long fontSize;
+	char* fontData = readWholeFile(fontName, fontSize);
+	TTF_ASSERT(fontData != nullptr);
+	Truetype::uint32 kernOffset = Truetype::findTableOffset(fontData, "kern");
+	Truetype::uint8* kern = (Truetype::uint8*)fontData + kernOffset;
+	if (kernOffset == 0 || Truetype::toUShort(kern) != 0 || (Truetype::toUShort(kern + 8) >> 8) != 0 || Truetype::toUShort(kern + 10) == 0)
+	{
+		free(fontData);
+		printf("No format 0 kern table to test the empty slot key with in '%s'\n", fontName);
+		return;
+	}
+
+	// The last pair of the first subtable sorts last as 0xFFFF, 0xFFFF, so stb's binary search still works
+	Truetype::uint8* lastPair = kern + 18 + (Truetype::toUShort(kern + 10) - 1) * 6;
+	const Truetype::uint8 pair[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0, 100 };
+	memcpy(lastPair, pair, sizeof(pair));
+
+	Truetype::FontInfo kernFont;
+	bool loaded = Truetype::initFont(kernFont, fontData, (int)fontSize);
+	TTF_ASSERT(loaded);
+	stbtt_fontinfo stbttFont;
+	stbtt_InitFont(&stbttFont, (unsigned char*)kernFont.data, 0);
+	int numGlyphs = kernFont.numGlyphs < 1024 ? kernFont.numGlyphs : 1024;
+	for (int left = 0; left < numGlyphs; left++)
+	{
+		for (int right = 0; right < numGlyphs; right++)
+		{
+			TTF_ASSERT(Truetype::getKernTableKerning(left, right, kernFont) == stbtt__GetGlyphKernInfoAdvance(&stbttFont, left, right));
+		}
+	}
+
+	// Glyph 0xFFFF can't exist, so it never kerns, and no lookup for a pair that isn't in the table finds the value
+	TTF_ASSERT(Truetype::getKernTableKerning(0xFFFF, 0xFFFF, kernFont) == 0);
+	int numMisses = 0;
+	for (Truetype::uint32 key = 0; key < 0xFFFFFFFFu; key += 0xFFF1)
+	{
+		int kerning = Truetype::getKernTableKerning(key >> 16, key & 0xFFFF, kernFont);
+		numMisses += kerning == 100 && stbtt__GetGlyphKernInfoAdvance(&stbttFont, key >> 16, key & 0xFFFF) != 100 ? 1 : 0;
+	}
+	TTF_ASSERT(numMisses == 0);
+	Truetype::freeFont(kernFont);
+	printf("Kern pair with the empty slot key is skipped in '%s'\n", fontName);
+}
+
+void testGlyphDecodeSimdMatchesScalar(Truetype::FontInfo& myFont, const char* fontName)
+{
+	for (int i = 0; i < myFont.numGlyphs; i++)
+	{
+		Truetype::Glyph glyph = Truetype::getGlyphById(i, myFont);
+		Truetype::GlyphData simdData = Truetype::getGlyphData(glyph, myFont);
+		Truetype::setSimdEnabled(false);
+		Truetype::GlyphData scalarData = Truetype::getGlyphData(glyph, myFont);
+		Truetype::setSimdEnabled(true);
+		TTF_ASSERT(glyphDataEqual(simdData, scalarData));
+		Truetype::freeGlyphData(simdData);
+		Truetype::freeGlyphData(scalarData);
+	}
+
+	printf("SIMD glyph decode matches scalar for '%s'\n", fontName);
+}
+
 int main()
 {
 	const char* fontNames[] = {
@@ -83,26 +1594,53 @@ int main()
 		"C:/Windows/Fonts/BowlbyOneSC-Regular.ttf",
 		"C:/Windows/Fonts/BKANT.TTF",
 		"C:/Windows/Fonts/SNAP____.TTF",
-		"C:/Windows/Fonts/STENCIL.TTF"
+		"C:/Windows/Fonts/STENCIL.TTF",
+		"C:/Windows/Fonts/seguiemj.ttf" // Has a format 12 cmap
 	};
-	int fontTestSize = 7;
+	int fontTestSize = 8;
+
+	testCoverageClipping();
 
 	for (int fontIndex=0; fontIndex < fontTestSize; fontIndex++)
 	{
-		File fontData = readFile(fontNames[fontIndex]);
-		if (!fontData.data)
+		Truetype::FontInfo fontInfo;
+		if (!Truetype::loadFont(fontInfo, fontNames[fontIndex]))
 		{
 			return -1;
 		}
 
 		stbtt_fontinfo font;
-		stbtt_InitFont(&font, (unsigned char*)fontData.data, stbtt_GetFontOffsetForIndex((unsigned char*)fontData.data, 0));
-
-		Truetype::FontInfo fontInfo;
-		Truetype::initFont(fontInfo, fontData.data, fontData.size);
+		stbtt_InitFont(&font, (unsigned char*)fontInfo.data, stbtt_GetFontOffsetForIndex((unsigned char*)fontInfo.data, 0));
 
 		testFontInfoMatch(font, fontInfo, fontNames[fontIndex]);
 		testFontGlyphIdsMatch(font, fontInfo, fontNames[fontIndex]);
+		testGlyphIdsBatchMatch(fontInfo, fontNames[fontIndex]);
+		testGlyphPageTableMatch(font, fontNames[fontIndex]);
+		testGlyphOffsetsMatch(font, fontInfo, fontNames[fontIndex]);
+		testHorizontalMetricsMatch(font, fontInfo, fontNames[fontIndex]);
+		testKerningMatch(font, fontInfo, fontNames[fontIndex]);
+		testGlyphDataMatch(font, fontInfo, fontNames[fontIndex]);
+		testGlyphSegmentsMatch(font, fontInfo, fontNames[fontIndex]);
+		testGlyphSegmentIterator(fontInfo, fontNames[fontIndex]);
+		testGlyphPolyline(fontInfo, fontNames[fontIndex]);
+		testGlyphRasterScanline(fontInfo, fontNames[fontIndex]);
+		testGlyphCoverage(font, fontInfo, fontNames[fontIndex]);
+		testGlyphPlacement(font, fontInfo, fontNames[fontIndex]);
+		testGlyphBitmapStride(fontInfo, fontNames[fontIndex]);
+		testWriteGlyphBitmap(fontInfo, fontNames[fontIndex]);
+		testGlyphScratchDecode(fontInfo, fontNames[fontIndex]);
+		testGlyphArenaDecode(fontInfo, fontNames[fontIndex]);
+		testGlyphDecodeSimdMatchesScalar(fontInfo, fontNames[fontIndex]);
+		testCompositeCacheMatch(fontInfo, fontNames[fontIndex]);
+		testGlyphCache(fontInfo, fontNames[fontIndex]);
+		testInternalFontParallelMatch(fontInfo, fontNames[fontIndex]);
+		testMalformedContourEnds(fontNames[fontIndex]);
+		testMaxpWithoutGlyphMaxima(fontInfo, fontNames[fontIndex]);
+		testFontCollection(font, fontInfo, fontNames[fontIndex]);
+		testKernEmptySlotKey(fontNames[fontIndex]);
+		testShortTables(fontInfo, fontNames[fontIndex]);
+		testLastResortCmap(fontInfo, fontNames[fontIndex]);
+		testGposClassCountOverflow(fontInfo, fontNames[fontIndex]);
 		printf("\n");
 
 		Truetype::freeFont(fontInfo);
@@ -9,7 +9,12 @@ project "TruetypeTests"
 	files {
         "include/**.h",
 		"cpp/**.cpp",
-		"../Truetype/include/**.h"
+		"../Truetype/include/**.h",
+		"../Truetype/cpp/**.cpp"
+	}
+
+	removefiles {
+		"../Truetype/cpp/main.cpp"
 	}
 
     disablewarnings { 
@@ -15,3 +15,4 @@ outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 include "Truetype"
 include "TruetypeExamples"
 include "TruetypeTests"
+include "TruetypeBenchmarks"